@@ -0,0 +1,260 @@
+#include "sidereal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// The fixed-point sidereal engine against the double-precision code the
+// face used before it (calc_mjd, mjd2gmst and gmst2lst, kept here as they
+// were, apart from taking the longitude as an argument instead of reading
+// it from flash). Every step seconds from 1900 to 2100, at each of a few
+// longitudes, it compares the MJD and the LST HH:MM the face would show,
+// and the LST itself; then it times both, including the gmtime() the old
+// code needed.
+//
+// Usage: accuracybench [step in seconds]
+//
+// Exits non-zero if any MJD or HH:MM differs, or the LSTs differ by more
+// than MAX_ERROR_S.
+
+#define MAX_ERROR_S 1e-5
+#define TURNS_TO_SECONDS (86400.0L / 18446744073709551616.0L)
+
+// 1900-01-01 and 2100-01-01.
+#define FIRST_TIME -2208988800LL
+#define LAST_TIME 4102444800LL
+
+// Longitudes to check at, in 1e-7 degrees: the prime meridian, ATCA, Los
+// Angeles, just west of Greenwich, and either side of the date line.
+static const int32_t s_longitudes_e7[] = {
+  0, 1495500000, -1182400000, -1000, 1799999000, -1799999000
+};
+
+#define NUM_LONGITUDES (sizeof(s_longitudes_e7) / sizeof(s_longitudes_e7[0]))
+
+// The old code, from here to gmst2lst.
+static double calc_day_fraction(struct tm *t) {
+  double dayfrac = 0.0;
+  dayfrac += (double)t->tm_hour + (double)t->tm_min / 60.0 + (double)t->tm_sec / 3600.0;
+  dayfrac /= 24.0;
+  return(dayfrac);
+}
+
+static double calc_mjd(struct tm *t) {
+  double day_fraction = calc_day_fraction(t);
+  double mjd;
+  int m, y, c, yy, x1, x2, x3;
+
+  if (t->tm_mon < 2) {
+    m = t->tm_mon + 10;
+    y = t->tm_year + 1900 - 1;
+  } else {
+    m = t->tm_mon - 2;
+    y = t->tm_year + 1900;
+  }
+
+  yy = y % 100;
+  c = (y - yy) / 100;
+  x1 = (int)(146097.0 * (double)c / 4.0);
+  x2 = (int)(1461.0 * (double)yy / 4.0);
+  x3 = (int)((153.0 * (double)m + 2.0) / 5.0);
+
+  mjd = (double)x1 + (double)x2 + (double)x3 + (double)t->tm_mday - 678882.0 + day_fraction;
+  return(mjd);
+}
+
+static double mjd2gmst(double mjd) {
+  double jdJ2000 = 2451545.0;
+  double jdCentury = 36525.0;
+  double dUT1 = 0.0;
+  double a = 101.0 + 24110.54841 / 86400.0;
+  double b = 8640184.812866 / 86400.0;
+  double e = 0.093104 / 86400.0;
+  double d = 0.0000062 / 86400.0;
+
+  double tu = ((double)((int)mjd) - (jdJ2000 - 2400000.5)) / jdCentury;
+  double sidTim = a + tu * (b + tu * (e - tu * d));
+  sidTim -= (double)((int)sidTim);
+  if (sidTim < 0) {
+    sidTim += 1;
+  }
+
+  double gmst = sidTim + (mjd - (double)((int)mjd) + dUT1 / 86400.0) * 1.002737909350795;
+  while (gmst < 0) {
+    gmst += 1;
+  }
+  while (gmst > 1) {
+    gmst -= 1;
+  }
+  return(gmst);
+}
+
+static double gmst2lst(double gmst, double longitude) {
+  longitude /= 360.0;
+  double lst = gmst + longitude;
+  while (lst > 1) {
+    lst -= 1;
+  }
+  while (lst < 0) {
+    lst += 1;
+  }
+  return(lst * 24.0);
+}
+
+// The old path from a time to the MJD shown and the LST in hours.
+static double old_lst(int64_t t, double longitude, int *mjd) {
+  time_t temp = (time_t)t;
+  struct tm utc;
+  double mjd_time;
+  gmtime_r(&temp, &utc);
+  mjd_time = calc_mjd(&utc);
+  *mjd = (int)mjd_time;
+  return(gmst2lst(mjd2gmst(mjd_time), longitude));
+}
+
+// And the new one, to the LST in turns.
+static turns_t new_lst(int64_t t, int32_t longitude_e7, int *mjd) {
+  int32_t day_seconds;
+  *mjd = sidereal_mjd(t, &day_seconds);
+  return(sidereal_gmst(*mjd, day_seconds) + sidereal_longitude(longitude_e7));
+}
+
+// A cycle counter where there is one, and nanoseconds otherwise.
+static uint64_t now_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char *argv[]) {
+  int64_t step = (argc > 1) ? atoll(argv[1]) : 7919;
+  uint64_t samples = 0, mjd_mismatches = 0, hhmm_mismatches = 0;
+  uint64_t best_old = UINT64_MAX, best_new = UINT64_MAX, best_gmtime = UINT64_MAX;
+  uint64_t start, elapsed;
+  double worst = 0, best_old_s = 1e30, best_new_s = 1e30, start_s, elapsed_s, checksum = 0;
+  size_t n = 0, i, l;
+  int64_t t, *times;
+  int r;
+
+  if (step < 1) {
+    fprintf(stderr, "usage: %s [step in seconds]\n", argv[0]);
+    return(1);
+  }
+  for (t = FIRST_TIME; t < LAST_TIME; t += step) {
+    n++;
+  }
+  times = malloc(n * sizeof(*times));
+  if (!times) {
+    return(1);
+  }
+  for (i = 0, t = FIRST_TIME; i < n; i++, t += step) {
+    times[i] = t;
+  }
+
+  for (l = 0; l < NUM_LONGITUDES; l++) {
+    int32_t longitude_e7 = s_longitudes_e7[l];
+    double longitude = (double)longitude_e7 / 1e7;
+    for (i = 0; i < n; i++) {
+      int old_mjd, new_mjd;
+      double hours = old_lst(times[i], longitude, &old_mjd);
+      turns_t lst = new_lst(times[i], longitude_e7, &new_mjd);
+      int old_hour = (int)hours, old_min = (int)((hours - (double)old_hour) * 60);
+      long double d = (long double)lst * TURNS_TO_SECONDS - (long double)hours * 3600.0L;
+      if (d > 43200.0L) {
+        d -= 86400.0L;
+      } else if (d < -43200.0L) {
+        d += 86400.0L;
+      }
+      samples++;
+      if (old_mjd != new_mjd) {
+        if (mjd_mismatches++ < 10) {
+          printf("MJD differs at %lld: %d, was %d\n", (long long)times[i], new_mjd, old_mjd);
+        }
+      }
+      if (old_hour * 60 + old_min != sidereal_minutes(lst)) {
+        if (hhmm_mismatches++ < 10) {
+          printf("LST differs at %lld, longitude %d: %d min, was %02d:%02d\n",
+                 (long long)times[i], longitude_e7, sidereal_minutes(lst), old_hour, old_min);
+        }
+      }
+      if (fabsl(d) > fabs(worst)) {
+        worst = (double)d;
+      }
+    }
+  }
+
+  for (r = 0; r < 10; r++) {
+    int mjd;
+    start_s = now_seconds();
+    start = now_cycles();
+    for (i = 0; i < n; i++) {
+      checksum += old_lst(times[i], 149.55, &mjd) + mjd;
+    }
+    elapsed = now_cycles() - start;
+    elapsed_s = now_seconds() - start_s;
+    if (elapsed < best_old) {
+      best_old = elapsed;
+    }
+    if (elapsed_s < best_old_s) {
+      best_old_s = elapsed_s;
+    }
+
+    start_s = now_seconds();
+    start = now_cycles();
+    for (i = 0; i < n; i++) {
+      checksum += (double)(new_lst(times[i], 1495500000, &mjd) >> 40) + mjd;
+    }
+    elapsed = now_cycles() - start;
+    elapsed_s = now_seconds() - start_s;
+    if (elapsed < best_new) {
+      best_new = elapsed;
+    }
+    if (elapsed_s < best_new_s) {
+      best_new_s = elapsed_s;
+    }
+
+    start = now_cycles();
+    for (i = 0; i < n; i++) {
+      time_t temp = (time_t)times[i];
+      struct tm utc;
+      gmtime_r(&temp, &utc);
+      checksum += utc.tm_min;
+    }
+    elapsed = now_cycles() - start;
+    if (elapsed < best_gmtime) {
+      best_gmtime = elapsed;
+    }
+  }
+
+  printf("samples:                   %llu (every %lld s from 1900 to 2100, %d longitudes)\n",
+         (unsigned long long)samples, (long long)step, (int)NUM_LONGITUDES);
+  printf("MJD mismatches:            %llu\n", (unsigned long long)mjd_mismatches);
+  printf("LST HH:MM mismatches:      %llu\n", (unsigned long long)hhmm_mismatches);
+  printf("worst |dLST|:              %.2f us\n", fabs(worst) * 1e6);
+#if defined(__x86_64__) || defined(__i386__)
+  printf("cycles per evaluation:     %.1f double (%.1f of it gmtime), %.1f fixed point\n",
+#else
+  printf("ns per evaluation:         %.1f double (%.1f of it gmtime), %.1f fixed point\n",
+#endif
+         (double)best_old / (double)n, (double)best_gmtime / (double)n,
+         (double)best_new / (double)n);
+  printf("ns per evaluation:         %.1f double, %.1f fixed point\n", best_old_s / n * 1e9,
+         best_new_s / n * 1e9);
+  printf("checksum:                  %.0f\n", checksum);
+  free(times);
+  return((mjd_mismatches || hhmm_mismatches || (fabs(worst) > MAX_ERROR_S)) ? 1 : 0);
+}
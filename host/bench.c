@@ -0,0 +1,424 @@
+#include "host.h"
+#include "catalogue.h"
+#include "config.h"
+#include "instrument.h"
+#include "settings.h"
+#include "sidereal.h"
+
+// Replay simulated clock ticks through the whole watchface at full speed,
+// and report what each update costs.
+//
+// Usage: bench [hours] [longitude in degrees] [sites] [sources] [seconds timeout]
+//
+// With more than one site, the others are spread 30 degrees apart to the
+// east of the first, and the watch is tapped every hour so the LST panel
+// cycles through each site and then all of them together. With sources, a
+// catalogue of that many made-up sources spread over the sky is loaded, the
+// sites are given the latitude of the ATCA, and the tapping carries on to
+// the sources panel too. The catalogue is sent along with the configuration
+// if it's small enough, and is otherwise the CATALOGUE resource. A negative
+// number of sources puts that many in the resource, and has the phone send
+// a catalogue with none in it, which should leave the resource in use. With a
+// seconds timeout, seconds mode is configured, and the wrist is flicked every
+// half timeout, so with one site the LST's seconds show for the whole run
+// (with more, the flicks while they show move the panel on instead).
+//
+// The configuration arrives just after launch, sent by a simulated phone
+// that follows the chunked protocol in config.h.
+//
+// The display's latency is measured from outside the face: for each
+// rollover of the solar minute, and (with one site and no sources, so that
+// the LST panel never moves) of the LST's minute or second, how long until
+// the next wakeup. It's measured from a minute in, once the configuration
+// has arrived.
+//
+// Built with INSTRUMENT, the simulated phone asks for the face's own stats
+// ten seconds before the end, and they're printed too.
+//
+// With BENCH_STATE set to a file, the watch's flash and clock are restored
+// from it if it exists, BENCH_GAP_MS (a second, by default) after the run
+// that saved them ended, and are saved to it at the end; so running twice times a relaunch, which can
+// start warm from the snapshot the first run's face left behind.
+
+// The face's own main(), renamed by the Makefile.
+int pebble_main(void);
+
+#define LATITUDE_E7 -303128846
+#define MAX_BENCH_SOURCES 1000
+
+// How long a message takes to get from the phone to the watch, or back.
+#define PHONE_LATENCY_MS 150
+
+// Fri 2026-10-16 00:00:12.345 UTC, so the first LST rollover isn't aligned.
+#define START_MS 1792108812345LL
+
+// How long after the last run the face is relaunched, with BENCH_STATE,
+// unless BENCH_GAP_MS says otherwise.
+#define RELAUNCH_GAP_MS 1000
+
+// How late the display is for each rollover of one clock: when the next one
+// is due, and the worst wait from one to the wakeup after it.
+typedef struct _rollover_latency {
+  int64_t next_ms;
+  int64_t worst_ms;
+  uint64_t rollovers;
+} rolloverLatency;
+
+static rolloverLatency s_solar_latency, s_lst_latency;
+static bool s_track_lst = false;
+static int32_t s_lst_longitude_e7;
+static turns_t s_lst_unit;
+static siderealAnchor s_bench_anchor;
+
+// How many sources the face had, as of the last wakeup.
+static int s_catalogue_count = 0;
+
+// The first millisecond after after_ms at which the LST has rolled over to
+// a new unit.
+static int64_t next_lst_rollover(int64_t after_ms) {
+  turns_t lst = sidereal_time2gmst(&s_bench_anchor, after_ms / 1000,
+                                   (uint16_t)(after_ms % 1000), NULL, NULL) +
+                sidereal_longitude(s_lst_longitude_e7);
+  turns_t remaining = s_lst_unit - lst % s_lst_unit;
+  return(after_ms + (int64_t)(remaining / SIDEREAL_RATE_MS) +
+         ((remaining % SIDEREAL_RATE_MS) ? 1 : 0));
+}
+
+static void count_latency(rolloverLatency *latency, int64_t at_ms) {
+  if (at_ms - latency->next_ms > latency->worst_ms) {
+    latency->worst_ms = at_ms - latency->next_ms;
+  }
+  latency->rollovers++;
+}
+
+static void bench_wakeup(int64_t at_ms) {
+  s_catalogue_count = catalogue_count();
+  while (s_solar_latency.next_ms <= at_ms) {
+    count_latency(&s_solar_latency, at_ms);
+    s_solar_latency.next_ms += 60000;
+  }
+  while (s_track_lst && (s_lst_latency.next_ms <= at_ms)) {
+    count_latency(&s_lst_latency, at_ms);
+    s_lst_latency.next_ms = next_lst_rollover(s_lst_latency.next_ms);
+  }
+}
+
+// The phone's copy of the configuration payload.
+static uint8_t s_payload[sizeof(configPayloadHeader) + MAX_SITES * sizeof(configSite) +
+                         CONFIG_MAX_CATALOGUE];
+static uint16_t s_payload_length = 0;
+static int s_chunks_sent = 0;
+
+static void send_chunk(int64_t at_ms, uint16_t offset) {
+  uint8_t message[sizeof(configChunkHeader) + CONFIG_CHUNK_DATA];
+  configChunkHeader header = { CONFIG_VERSION, 0, s_payload_length, offset };
+  uint16_t n = s_payload_length - offset;
+  if (n > CONFIG_CHUNK_DATA) {
+    n = CONFIG_CHUNK_DATA;
+  }
+  memcpy(message, &header, sizeof(header));
+  memcpy(message + sizeof(header), s_payload + offset, n);
+  host_queue_message_data(at_ms, KEY_CONFIG_CHUNK, message, sizeof(header) + n);
+  s_chunks_sent++;
+}
+
+// The face's stats, as the phone has them.
+static instrumentSummary s_summary;
+static probeStats s_probes[NUM_PROBES];
+static int s_stats_records = 0;
+
+static void stats_received(const Tuple *stats_t) {
+  instrumentHeader header;
+  if (stats_t->length < sizeof(header)) {
+    return;
+  }
+  memcpy(&header, stats_t->value->data, sizeof(header));
+  if ((header.index == 0) && (stats_t->length == sizeof(header) + sizeof(s_summary))) {
+    memcpy(&s_summary, stats_t->value->data + sizeof(header), sizeof(s_summary));
+  } else if ((header.index > 0) && (header.index <= NUM_PROBES) &&
+             (stats_t->length == sizeof(header) + sizeof(probeStats))) {
+    memcpy(&s_probes[header.index - 1], stats_t->value->data + sizeof(header), sizeof(probeStats));
+  } else {
+    return;
+  }
+  s_stats_records++;
+  if (header.index + 1 < header.num_records) {
+    host_queue_message_int32(host_get_time_ms() + 2 * PHONE_LATENCY_MS, KEY_STATS_REQUEST,
+                             header.index + 1);
+  }
+}
+
+#ifdef INSTRUMENT
+// The upper bound of the bucket holding the given fraction (in percent) of
+// a probe's times, in microseconds.
+static uint32_t percentile_us(const probeStats *stats, int percent) {
+  uint32_t wanted = (uint32_t)(((uint64_t)stats->count * percent + 99) / 100), seen = 0;
+  int bucket;
+  for (bucket = 0; bucket < INSTRUMENT_BUCKETS - 1; bucket++) {
+    seen += stats->buckets[bucket];
+    if (seen >= wanted) {
+      return(1U << bucket);
+    }
+  }
+  return(stats->max_us);
+}
+
+static void print_face_stats(void) {
+  static const char *const probe_names[NUM_PROBES] = {
+    "timer", "tap", "message", "update_time", "gmst", "format", "lst panel",
+    "flush", "draw", "latency"
+  };
+  static const char *const counter_names[NUM_COUNTERS] = {
+    "flash reads", "flash writes", "messages in", "bytes in", "messages dropped",
+    "messages out", "bytes out", "sends failed"
+  };
+  int i;
+  printf("face's stats:              %d of %d records, after %lu s\n", s_stats_records,
+         1 + NUM_PROBES, (unsigned long)s_summary.uptime_s);
+  for (i = 0; i < NUM_COUNTERS; i++) {
+    printf("  %-17s %lu\n", counter_names[i], (unsigned long)s_summary.counters[i]);
+  }
+  printf("  %-17s", "redraws");
+  for (i = 0; i < NUM_FIELDS; i++) {
+    printf(" %lu", (unsigned long)s_summary.redraws[i]);
+  }
+  printf("\n  %-17s %8s %9s %9s %9s\n", "probe", "count", "mean us", "max us", "p99 < us");
+  for (i = 0; i < NUM_PROBES; i++) {
+    const probeStats *stats = &s_probes[i];
+    printf("  %-17s %8lu %9.1f %9lu %9lu\n", probe_names[i], (unsigned long)stats->count,
+           stats->count ? (double)stats->total_us / (double)stats->count : 0.0,
+           (unsigned long)stats->max_us, (unsigned long)percentile_us(stats, 99));
+  }
+}
+#endif
+
+// The watch has acked a chunk: send the next, if there is one.
+static void phone_received(const DictionaryIterator *iter) {
+  Tuple *ack_t = dict_find(iter, KEY_CONFIG_ACK);
+  Tuple *stats_t = dict_find(iter, KEY_STATS);
+  if (stats_t) {
+    stats_received(stats_t);
+  }
+  if (!ack_t) {
+    return;
+  }
+  if (ack_t->value->int32 < 0) {
+    fprintf(stderr, "watch refused the configuration: %ld\n", (long)ack_t->value->int32);
+  } else if (ack_t->value->int32 < s_payload_length) {
+    send_chunk(host_get_time_ms() + 2 * PHONE_LATENCY_MS, (uint16_t)ack_t->value->int32);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  double hours = (argc > 1) ? atof(argv[1]) : 24.0;
+  double longitude = (argc > 2) ? atof(argv[2]) : 149.5501388;
+  int sites = (argc > 3) ? atoi(argv[3]) : 1;
+  int sources = (argc > 4) ? atoi(argv[4]) : 0;
+  int seconds_timeout = (argc > 5) ? atoi(argv[5]) : 0;
+  const char *state_path = getenv("BENCH_STATE");
+  bool relaunched = false, empty_catalogue = (sources < 0);
+  int64_t start_ms;
+  configPayloadHeader payload_header = { CONFIG_VERSION, 0, 0, 0, 0, 0 };
+  size_t catalogue_length;
+  static struct {
+    catalogueHeader header;
+    catalogueSource sources[MAX_BENCH_SOURCES];
+  } catalogue;
+  int64_t run_ms = (int64_t)(hours * 3600000.0);
+  int64_t t;
+  int i;
+
+#ifdef PBL_PLATFORM_CHALK
+  const char *platform = "chalk";
+  int screen_h = 180;
+  host_set_screen_size(180, screen_h);
+#else
+  const char *platform = "basalt";
+  int screen_h = 168;
+  host_set_screen_size(144, screen_h);
+#endif
+#ifdef RENDER_CANVAS
+  const char *render_mode = "canvas";
+#else
+  const char *render_mode = "text layers";
+#endif
+  host_set_logging(getenv("BENCH_LOG") != NULL);
+  host_set_time_ms(START_MS);
+  if (state_path && host_load_state(state_path)) {
+    relaunched = true;
+    host_set_time_ms(host_get_time_ms() +
+                     (getenv("BENCH_GAP_MS") ? atoll(getenv("BENCH_GAP_MS")) : RELAUNCH_GAP_MS));
+  }
+  start_ms = host_get_time_ms();
+  host_set_run_length_ms(run_ms);
+  if (sites < 1) {
+    sites = 1;
+  }
+  if (empty_catalogue) {
+    sources = -sources;
+  }
+  if (sources > MAX_BENCH_SOURCES) {
+    sources = MAX_BENCH_SOURCES;
+  }
+  if (sources > 0) {
+    // Even in right ascension, and from -80 to +40 degrees in declination.
+    memcpy(catalogue.header.magic, CATALOGUE_MAGIC, sizeof(catalogue.header.magic));
+    catalogue.header.num_sources = (uint16_t)sources;
+    catalogue.header.record_size = sizeof(catalogueSource);
+    for (i = 0; i < sources; i++) {
+      catalogueSource *source = &catalogue.sources[i];
+      snprintf(source->name, sizeof(source->name), "SRC%03d", i);
+      source->ra = (uint32_t)(((uint64_t)i << 32) / (uint64_t)sources);
+      source->dec = (int32_t)((-80.0 + 120.0 * ((i * 7) % sources) / sources) / 360.0 * 4294967296.0);
+      source->elevation_limit = (int32_t)(12.0 / 360.0 * 4294967296.0);
+    }
+  }
+  catalogue_length = sizeof(catalogueHeader) + sources * sizeof(catalogueSource);
+  if (empty_catalogue) {
+    host_set_resource(RESOURCE_ID_CATALOGUE, &catalogue, catalogue_length);
+    payload_header.flags |= CONFIG_HAS_CATALOGUE;
+    payload_header.catalogue_length = sizeof(catalogueHeader);
+  } else if (sources > 0) {
+    if (catalogue_length <= CONFIG_MAX_CATALOGUE) {
+      payload_header.flags |= CONFIG_HAS_CATALOGUE;
+      payload_header.catalogue_length = (uint16_t)catalogue_length;
+    } else {
+      host_set_resource(RESOURCE_ID_CATALOGUE, &catalogue, catalogue_length);
+    }
+  }
+
+  // Put the configuration together and send the first chunk.
+  if (seconds_timeout > 255) {
+    seconds_timeout = 255;
+  }
+  if (seconds_timeout > 0) {
+    payload_header.seconds_timeout_s = (uint8_t)seconds_timeout;
+  }
+  if (sites > MAX_SITES) {
+    sites = MAX_SITES;
+  }
+  payload_header.num_sites = (uint8_t)sites;
+  s_payload_length = sizeof(payload_header);
+  for (i = 0; i < sites; i++) {
+    static const char *names[] = { "ATCA", "Parkes", "Mopra", "Tidbinb" };
+    configSite site;
+    int64_t site_longitude_e7 = (int64_t)(longitude * 1e7) + 300000000LL * i;
+    if (site_longitude_e7 > 1800000000LL) {
+      site_longitude_e7 -= 3600000000LL;
+    }
+    memset(&site, 0, sizeof(site));
+    site.longitude_e7 = (int32_t)site_longitude_e7;
+    site.latitude_e7 = (sources > 0) ? LATITUDE_E7 : 0;
+    strncpy(site.name, names[i], sizeof(site.name) - 1);
+    memcpy(s_payload + s_payload_length, &site, sizeof(site));
+    s_payload_length += sizeof(site);
+  }
+  if (payload_header.flags & CONFIG_HAS_CATALOGUE) {
+    catalogueHeader header = catalogue.header;
+    header.num_sources = empty_catalogue ? 0 : header.num_sources;
+    memcpy(s_payload + s_payload_length, &header, sizeof(header));
+    memcpy(s_payload + s_payload_length + sizeof(header), catalogue.sources,
+           payload_header.catalogue_length - sizeof(header));
+    s_payload_length += payload_header.catalogue_length;
+  }
+  memcpy(s_payload, &payload_header, sizeof(payload_header));
+  host_set_outbox_handler(phone_received);
+  send_chunk(start_ms + 1000, 0);
+
+  if ((sites > 1) || (sources > 0)) {
+    for (t = start_ms + 1800000; t < start_ms + run_ms; t += 3600000) {
+      host_queue_tap(t);
+    }
+  }
+
+  if (seconds_timeout > 0) {
+    // Flicked just after the configuration has arrived.
+    for (t = start_ms + 5000; t < start_ms + run_ms; t += 500 * (int64_t)seconds_timeout) {
+      host_queue_tap(t);
+    }
+  }
+
+#ifdef INSTRUMENT
+  host_queue_message_int32(start_ms + run_ms - 10000, KEY_STATS_REQUEST, 0);
+#endif
+
+  // Start measuring the latency a minute in.
+  s_solar_latency.next_ms = start_ms - start_ms % 60000 + 120000;
+  s_track_lst = (sites == 1) && (sources == 0);
+  s_lst_longitude_e7 = (int32_t)(longitude * 1e7);
+  s_lst_unit = (seconds_timeout > 0) ? SIDEREAL_SECOND : SIDEREAL_MINUTE;
+  s_lst_latency.next_ms = next_lst_rollover(start_ms + 60000);
+  host_set_wakeup_handler(bench_wakeup);
+
+  host_start_launch();
+  pebble_main();
+  if (state_path) {
+    host_save_state(state_path);
+  }
+
+  const HostStats *stats = host_get_stats();
+  double minutes = (double)run_ms / 60000.0;
+  printf("platform:                  %s, %s\n", platform, render_mode);
+  printf("simulated:                 %.1f h, longitude %.7f, %d site%s, %d sources\n", hours,
+         longitude, sites, (sites == 1) ? "" : "s", sources);
+  printf("catalogue:                 %d sources on the watch%s\n", s_catalogue_count,
+         empty_catalogue ? ", after the phone sent one with none" : "");
+  printf("seconds mode:              %s\n",
+         (seconds_timeout > 0) ? "on, flicked throughout" : "off");
+  printf("wakeups:                   %llu (%.1f per hour)\n",
+         (unsigned long long)stats->wakeups, (double)stats->wakeups / hours);
+  printf("display latency:           solar minute %lld ms worst of %llu rollovers",
+         (long long)s_solar_latency.worst_ms, (unsigned long long)s_solar_latency.rollovers);
+  if (s_track_lst) {
+    printf(", LST %s %lld ms worst of %llu\n", (seconds_timeout > 0) ? "second" : "minute",
+           (long long)s_lst_latency.worst_ms, (unsigned long long)s_lst_latency.rollovers);
+  } else {
+    printf(" (LST not tracked with the panel moving)\n");
+  }
+  printf("ns per update_time():      %.0f mean, %llu max\n",
+         stats->wakeups ? (double)stats->wakeup_ns_total / (double)stats->wakeups : 0.0,
+         (unsigned long long)stats->wakeup_ns_max);
+  printf("persist reads per minute:  %.3f (%llu during the loop, %llu in total)\n",
+         (double)stats->loop_persist_reads / minutes,
+         (unsigned long long)stats->loop_persist_reads,
+         (unsigned long long)stats->persist_reads);
+  printf("persist writes:            %llu\n", (unsigned long long)stats->persist_writes);
+  printf("text_layer_set_text calls: %llu (%.1f per hour)\n",
+         (unsigned long long)stats->set_text_calls,
+         (double)stats->set_text_calls / hours);
+  printf("layer dirty marks:         %llu\n", (unsigned long long)stats->layer_dirty_marks);
+  printf("frames rendered:           %llu, %.0f ns mean, %llu ns max\n",
+         (unsigned long long)stats->frames,
+         stats->frames ? (double)stats->frame_ns_total / (double)stats->frames : 0.0,
+         (unsigned long long)stats->frame_ns_max);
+  printf("per frame:                 %.1f layers, %.1f text draws, %.0f pixels filled\n",
+         stats->frames ? (double)stats->layers_drawn / (double)stats->frames : 0.0,
+         stats->frames ? (double)stats->text_draws / (double)stats->frames : 0.0,
+         stats->frames ? (double)stats->pixels_filled / (double)stats->frames : 0.0);
+  printf("rows sent per frame:       %.1f of %d\n",
+         stats->frames ? (double)stats->rows_sent / (double)stats->frames : 0.0,
+         screen_h);
+  printf("CPU per simulated second:  %.0f ns in updates and drawing\n",
+         (double)(stats->wakeup_ns_total + stats->frame_ns_total) / ((double)run_ms / 1000.0));
+  printf("window load:               %llu ns\n", (unsigned long long)stats->window_load_ns);
+  printf("first frame:               %llu ns after launch, %llu flash reads before it (%s)\n",
+         (unsigned long long)stats->first_frame_ns,
+         (unsigned long long)stats->first_frame_persist_reads,
+         relaunched ? "relaunched" : "first launch");
+  printf("first current frame:       %llu ns after launch, %llu flash reads before it\n",
+         (unsigned long long)stats->current_frame_ns,
+         (unsigned long long)stats->current_frame_persist_reads);
+  printf("app messages:              %llu chunks sent for a %u byte configuration, %llu received, "
+         "%llu dropped, %llu acks\n", (unsigned long long)s_chunks_sent, s_payload_length,
+         (unsigned long long)stats->messages_received, (unsigned long long)stats->messages_dropped,
+         (unsigned long long)stats->messages_sent);
+  printf("AppMessage buffers:        %lu byte inbox, %lu byte outbox\n",
+         (unsigned long)stats->inbox_size, (unsigned long)stats->outbox_size);
+  printf("heap after launch:         %zu bytes\n", stats->heap_at_loop_start);
+  printf("heap high-water mark:      %zu bytes (%zu still allocated at exit)\n",
+         stats->heap_peak, stats->heap_current);
+#ifdef INSTRUMENT
+  print_face_stats();
+#endif
+  return(0);
+}
@@ -0,0 +1,149 @@
+#include "host.h"
+#include "catalogue.h"
+
+#include <math.h>
+
+// Check the rise and set hour angles the catalogue works out in fixed point
+// against the spherical trigonometry in double precision, for sources
+// whose cos H is 0 (on the equator, or seen from it) and ones that graze
+// the horizon or the pole, as well as ordinary ones. Each source is sent
+// as a one-source catalogue from the phone, and asked about at its
+// transit, when it should be up with H to go until it sets. It also checks
+// that a catalogue replaced by a smaller one, or by none, leaves none of
+// its blocks behind in flash.
+//
+// Usage: cataloguetest
+//
+// Exits non-zero if any source is in the wrong state, or more than
+// MAX_ERROR_MINUTES from when it should set.
+
+#define MAX_ERROR_MINUTES 2
+
+// Solar minutes in a sidereal day.
+#define MINUTES_PER_TURN 1436.0682
+
+typedef struct _rise_case {
+  const char *what;
+  double latitude;
+  double dec;
+  double elevation_limit;
+} riseCase;
+
+static const riseCase s_cases[] = {
+  { "equator, at the horizon", 0, 0, 0 },
+  { "pole from the equator", 0, 89.9, 0 },
+  { "equator from 60 N", 60, 0, 0 },
+  { "pole from 30 S", -30, -89.9, 0 },
+  { "grazing the horizon", -30, -59.5, 0 },
+  { "never above its limit", -30, 40, 30 },
+  { "ATCA, above 12 degrees", -30.3128846, -20, 12 }
+};
+
+#define NUM_CASES (sizeof(s_cases) / sizeof(s_cases[0]))
+
+// The first of catalogue.c's persist keys for the blocks of a catalogue,
+// and how many a catalogue of BIG_SOURCES takes.
+#define PERSIST_KEY_CATALOGUE 17
+#define BIG_SOURCES 40
+#define BIG_BLOCKS 4
+
+// Store a catalogue of n made-up sources.
+static bool store_sources(int n) {
+  static uint8_t data[sizeof(catalogueHeader) + BIG_SOURCES * sizeof(catalogueSource)];
+  catalogueHeader header = { { 'C', 'A', 'T', '1' }, (uint16_t)n, sizeof(catalogueSource) };
+  int i;
+  memset(data, 0, sizeof(data));
+  memcpy(data, &header, sizeof(header));
+  for (i = 0; i < n; i++) {
+    catalogueSource *source = (catalogueSource *)(data + sizeof(header)) + i;
+    snprintf(source->name, sizeof(source->name), "src%d", i);
+    source->ra = (uint32_t)i << 26;
+  }
+  return(catalogue_store(data, sizeof(header) + (size_t)n * sizeof(catalogueSource)));
+}
+
+// How many of a big catalogue's blocks are in flash.
+static int blocks_stored(void) {
+  int key, n = 0;
+  for (key = PERSIST_KEY_CATALOGUE; key < PERSIST_KEY_CATALOGUE + BIG_BLOCKS; key++) {
+    n += persist_exists((uint32_t)key) ? 1 : 0;
+  }
+  return(n);
+}
+
+static int32_t degrees_to_turns32(double degrees) {
+  return((int32_t)(int64_t)(degrees / 360.0 * 4294967296.0));
+}
+
+static const char *state_name(int count, sourceState state) {
+  if (count == 0) {
+    return("never up");
+  }
+  return((state == SOURCE_ALWAYS_UP) ? "always up" : (state == SOURCE_UP) ? "up" : "down");
+}
+
+int main(void) {
+  uint8_t data[sizeof(catalogueHeader) + sizeof(catalogueSource)];
+  catalogueHeader header = { { 'C', 'A', 'T', '1' }, 1, sizeof(catalogueSource) };
+  catalogueSource source;
+  int failures = 0;
+  size_t i;
+
+  for (i = 0; i < NUM_CASES; i++) {
+    const riseCase *c = &s_cases[i];
+    double rad = M_PI / 180;
+    double cos_h = (sin(c->elevation_limit * rad) - sin(c->latitude * rad) * sin(c->dec * rad)) /
+                   (cos(c->latitude * rad) * cos(c->dec * rad));
+    int expected_count = (cos_h >= 1) ? 0 : 1;
+    sourceState expected_state = (cos_h <= -1) ? SOURCE_ALWAYS_UP : SOURCE_UP;
+    double expected_minutes = ((cos_h <= -1) || (cos_h >= 1)) ? 0 :
+                              acos(cos_h) / (2 * M_PI) * MINUTES_PER_TURN;
+    sourceStatus top[1];
+    int count;
+    bool ok;
+
+    memset(&source, 0, sizeof(source));
+    snprintf(source.name, sizeof(source.name), "case%d", (int)i);
+    source.ra = 0x40000000;
+    source.dec = degrees_to_turns32(c->dec);
+    source.elevation_limit = degrees_to_turns32(c->elevation_limit);
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), &source, sizeof(source));
+    if (!catalogue_store(data, sizeof(data))) {
+      printf("%s: catalogue not stored\n", c->what);
+      failures++;
+      continue;
+    }
+    count = catalogue_update(0, (int32_t)lround(c->latitude * 1e7), source.ra, top, 1);
+    ok = (count == expected_count);
+    if (ok && count) {
+      ok = (top[0].state == expected_state) &&
+           (fabs(top[0].minutes - expected_minutes) <= MAX_ERROR_MINUTES);
+    }
+    printf("%-26s %-9s %4d min, expected %-9s %7.1f min%s\n", c->what,
+           state_name(count, count ? top[0].state : SOURCE_DOWN), count ? (int)top[0].minutes : 0,
+           state_name(expected_count, expected_state), expected_minutes, ok ? "" : "  FAILED");
+    if (!ok) {
+      failures++;
+    }
+  }
+
+  // A big catalogue, then a small one, then none.
+  if (!store_sources(BIG_SOURCES) || (blocks_stored() != BIG_BLOCKS) ||
+      (catalogue_count() != BIG_SOURCES)) {
+    printf("big catalogue: %d blocks stored, expected %d\n", blocks_stored(), BIG_BLOCKS);
+    failures++;
+  }
+  if (!store_sources(1) || (blocks_stored() != 1) || (catalogue_count() != 1)) {
+    printf("small catalogue: %d blocks stored, expected 1\n", blocks_stored());
+    failures++;
+  }
+  if (!store_sources(0) || (blocks_stored() != 0)) {
+    printf("no catalogue: %d blocks stored, expected 0\n", blocks_stored());
+    failures++;
+  }
+  printf("blocks left behind:        %d\n", blocks_stored());
+  catalogue_unload();
+  printf("failures:                  %d of %d\n", failures, (int)NUM_CASES + 3);
+  return(failures ? 1 : 0);
+}
@@ -0,0 +1,127 @@
+#include "sidereal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Check that stepping GMST on from the day's anchor, as the watch does on
+// every update, never drifts from evaluating it from scratch. It walks the
+// watch's clock forward every step seconds from 1900 to 2100 through one
+// anchor, as a face left running for two centuries would, then jumps about
+// at random, as a clock being set would, and compares each stepped GMST
+// with sidereal_gmst(). Every so often it also checks both against the
+// IAU 1982 expression in long double arithmetic.
+//
+// Usage: drifttest [step in seconds]
+//
+// Exits non-zero if the stepped GMST is ever more than MAX_DRIFT_S from
+// the one worked out from scratch, or either is more than MAX_ERROR_S from
+// the reference.
+
+#define MAX_DRIFT_S 1.0
+#define MAX_ERROR_S 1e-4
+#define TURNS_TO_SECONDS (86400.0L / 18446744073709551616.0L)
+
+// 1900-01-01 and 2100-01-01.
+#define FIRST_TIME -2208988800LL
+#define LAST_TIME 4102444800LL
+
+// How many of the steps, and of the random times, go against the reference.
+#define REFERENCE_EVERY 1009
+#define RANDOM_TIMES 10000000
+
+// The IAU 1982 expression for GMST, in seconds of sidereal time into the
+// day, in long double arithmetic.
+static long double reference_gmst(int64_t t) {
+  long double days = floorl((long double)t / 86400.0L);
+  long double ut = (long double)t - days * 86400.0L;
+  long double t0 = (days + MJD_UNIX_EPOCH - 51544.5L) / 36525.0L;
+  long double gmst = 24110.54841L + t0 * (8640184.812866L + t0 * (0.093104L - t0 * 6.2e-6L)) +
+                     1.002737909350795L * ut;
+  return(fmodl(fmodl(gmst, 86400.0L) + 86400.0L, 86400.0L));
+}
+
+// The difference between a GMST in turns and one in seconds, in seconds.
+static double gmst_error(turns_t gmst, long double seconds) {
+  long double d = (long double)gmst * TURNS_TO_SECONDS - seconds;
+  if (d > 43200.0L) {
+    d -= 86400.0L;
+  } else if (d < -43200.0L) {
+    d += 86400.0L;
+  }
+  return((double)d);
+}
+
+// A fast, repeatable stream of pseudo-random numbers.
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return(*state);
+}
+
+typedef struct _drift {
+  uint64_t updates;
+  // The worst difference between stepped and from scratch, in 2^-64 turns.
+  uint64_t worst_drift;
+  double worst_error;
+} drift;
+
+// Step the anchor to t, and see how it compares.
+static void check(drift *d, siderealAnchor *anchor, int64_t t, bool against_reference) {
+  int32_t day_seconds;
+  turns_t stepped = sidereal_time2gmst(anchor, t, 0, NULL, NULL);
+  int32_t mjd = sidereal_mjd(t, &day_seconds);
+  turns_t scratch = sidereal_gmst(mjd, day_seconds);
+  turns_t difference = stepped - scratch;
+  if ((int64_t)difference < 0) {
+    difference = -difference;
+  }
+  if (difference > d->worst_drift) {
+    d->worst_drift = difference;
+  }
+  if (against_reference) {
+    double error = gmst_error(stepped, reference_gmst(t));
+    if (fabs(error) > fabs(d->worst_error)) {
+      d->worst_error = error;
+    }
+  }
+  d->updates++;
+}
+
+int main(int argc, char *argv[]) {
+  int64_t step = (argc > 1) ? atoll(argv[1]) : 20;
+  siderealAnchor anchor = { false, 0, 0 };
+  drift walked = { 0, 0, 0 }, jumped = { 0, 0, 0 };
+  uint64_t state = 0x9e3779b97f4a7c15ULL, i = 0;
+  double worst_drift_s;
+  int64_t t;
+
+  if (step < 1) {
+    fprintf(stderr, "usage: %s [step in seconds]\n", argv[0]);
+    return(1);
+  }
+  for (t = FIRST_TIME; t < LAST_TIME; t += step, i++) {
+    check(&walked, &anchor, t, (i % REFERENCE_EVERY) == 0);
+  }
+  for (i = 0; i < RANDOM_TIMES; i++) {
+    t = FIRST_TIME + (int64_t)(next_random(&state) % (uint64_t)(LAST_TIME - FIRST_TIME));
+    check(&jumped, &anchor, t, (i % REFERENCE_EVERY) == 0);
+  }
+
+  worst_drift_s = (double)((walked.worst_drift > jumped.worst_drift) ? walked.worst_drift :
+                           jumped.worst_drift) * (double)TURNS_TO_SECONDS;
+  printf("updates:                   %llu every %lld s from 1900 to 2100, %llu at random\n",
+         (unsigned long long)walked.updates, (long long)step,
+         (unsigned long long)jumped.updates);
+  printf("worst drift, stepped:      %llu (2^-64 turns), walking; %llu jumping\n",
+         (unsigned long long)walked.worst_drift, (unsigned long long)jumped.worst_drift);
+  printf("worst error vs IAU 1982:   %.2e s walking, %.2e s jumping\n", walked.worst_error,
+         jumped.worst_error);
+  if ((worst_drift_s > MAX_DRIFT_S) || (fabs(walked.worst_error) > MAX_ERROR_S) ||
+      (fabs(jumped.worst_error) > MAX_ERROR_S)) {
+    printf("FAILED: bounds are %g s of drift and %g s of error\n", MAX_DRIFT_S, MAX_ERROR_S);
+    return(1);
+  }
+  return(0);
+}
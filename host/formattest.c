@@ -0,0 +1,163 @@
+#include "format.h"
+#include "sidereal.h"
+
+#include <limits.h>
+
+// Check the face's formatters byte for byte against the strftime and
+// snprintf calls they replaced, then time the two ways of writing the
+// fields an update shows.
+//
+// The date and the clocks are checked every step seconds from 1970 to 2100
+// in each of a few time zones, the LST and hour-angle formats at every
+// minute they can be given, the seconds at every second, and the MJD at
+// every value up to 200000 and at the largest int32_t.
+//
+// Usage: formattest [step in seconds]
+//
+// Exits non-zero if any string differs.
+
+#define FIRST_TIME 0LL
+#define LAST_TIME 4102444800LL
+
+static const char *const s_zones[] = {
+  "UTC", "Australia/Sydney", "America/New_York", "Asia/Kolkata"
+};
+
+#define NUM_ZONES (sizeof(s_zones) / sizeof(s_zones[0]))
+
+static int s_failures = 0;
+
+// Compare what a formatter wrote with what libc did, and if end isn't NULL,
+// check it's the end of the string the formatter returned.
+static void compare(const char *what, long long at, const char *got, const char *end,
+                    const char *expected) {
+  if ((strcmp(got, expected) != 0) || (end && (end != got + strlen(got)))) {
+    if (s_failures < 10) {
+      printf("%s at %lld: \"%s\", expected \"%s\"\n", what, at, got, expected);
+    }
+    s_failures++;
+  }
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+}
+
+// The fields the face shows of time t, the old way and the new.
+typedef struct _fields {
+  char local_time[8];
+  char local_date[23];
+  char utc_time[8];
+  char mjd[FORMAT_MJD_LENGTH];
+} fields;
+
+static void format_libc(fields *f, time_t t) {
+  struct tm *local = localtime(&t);
+  strftime(f->local_time, sizeof(f->local_time), "%H:%M", local);
+  strftime(f->local_date, sizeof(f->local_date), "%a %Y-%m-%d DOY %j", local);
+  snprintf(f->mjd, 12, "MJD %d  ", (int)(t / 86400 + MJD_UNIX_EPOCH));
+  strftime(f->utc_time, sizeof(f->utc_time), "%H:%M", gmtime(&t));
+}
+
+static void format_face(fields *f, time_t t) {
+  struct tm *local = localtime(&t);
+  int32_t utc_seconds;
+  int32_t mjd = sidereal_mjd((int64_t)t, &utc_seconds);
+  format_hhmm(f->local_time, local->tm_hour * 60 + local->tm_min);
+  format_date(f->local_date, local);
+  format_mjd(f->mjd, mjd);
+  format_hhmm(f->utc_time, utc_seconds / 60);
+}
+
+int main(int argc, char *argv[]) {
+  long long step = (argc > 1) ? atoll(argv[1]) : 3593;
+  static const int32_t mjds[] = { 0, 9, 10, 99999, 100000, INT32_MAX - 1, INT32_MAX };
+  char buffer[32], expected[32];
+  double best_libc = 1e30, best_face = 1e30, start, elapsed;
+  unsigned long long checksum = 0, strings = 0;
+  fields old_fields, new_fields;
+  long long t;
+  size_t z;
+  int i, r;
+
+  if (step < 1) {
+    fprintf(stderr, "usage: %s [step in seconds]\n", argv[0]);
+    return(1);
+  }
+
+  for (i = -1440; i < 2 * 1440; i++) {
+    if ((i >= 0) && (i < 1440)) {
+      snprintf(expected, 6, "%02d:%02d", i / 60, i % 60);
+      compare("format_hhmm", i, buffer, format_hhmm(buffer, i), expected);
+    }
+    snprintf(expected, sizeof(expected), "%s%d:%02d", (i < 0) ? "-" : "", abs(i) / 60,
+             abs(i) % 60);
+    compare("format_hmm", i, buffer, format_hmm(buffer, i), expected);
+  }
+  for (i = 0; i < 60; i++) {
+    snprintf(expected, sizeof(expected), "%02d", i);
+    compare("format_ss", i, buffer, format_ss(buffer, i), expected);
+  }
+  for (i = 0; i < 200000; i++) {
+    snprintf(expected, sizeof(expected), "MJD %d  ", i);
+    compare("format_mjd", i, buffer, format_mjd(buffer, i), expected);
+  }
+  for (i = 0; i < (int)(sizeof(mjds) / sizeof(mjds[0])); i++) {
+    // Fill the buffer first, so that an overrun past the NUL would show.
+    memset(buffer, 'x', sizeof(buffer));
+    snprintf(expected, sizeof(expected), "MJD %d  ", (int)mjds[i]);
+    compare("format_mjd", mjds[i], buffer, format_mjd(buffer, mjds[i]), expected);
+    if ((strlen(expected) + 1 > FORMAT_MJD_LENGTH) || (buffer[FORMAT_MJD_LENGTH] != 'x')) {
+      printf("format_mjd(%ld) is longer than FORMAT_MJD_LENGTH\n", (long)mjds[i]);
+      s_failures++;
+    }
+  }
+
+  for (z = 0; z < NUM_ZONES; z++) {
+    setenv("TZ", s_zones[z], 1);
+    tzset();
+    for (t = FIRST_TIME; t < LAST_TIME; t += step) {
+      format_libc(&old_fields, (time_t)t);
+      format_face(&new_fields, (time_t)t);
+      compare("local time", t, new_fields.local_time, NULL, old_fields.local_time);
+      compare("local date", t, new_fields.local_date, NULL, old_fields.local_date);
+      compare("UTC time", t, new_fields.utc_time, NULL, old_fields.utc_time);
+      compare("MJD", t, new_fields.mjd, NULL, old_fields.mjd);
+      strings += 4;
+    }
+  }
+
+  // Every step seconds of the range in the last zone, the old way and the
+  // new, both including the localtime() the fields need.
+  for (r = 0; r < 3; r++) {
+    start = now_seconds();
+    for (t = FIRST_TIME; t < LAST_TIME; t += step) {
+      format_libc(&old_fields, (time_t)t);
+      checksum += (unsigned char)old_fields.local_time[4] + (unsigned char)old_fields.mjd[8];
+    }
+    elapsed = now_seconds() - start;
+    if (elapsed < best_libc) {
+      best_libc = elapsed;
+    }
+    start = now_seconds();
+    for (t = FIRST_TIME; t < LAST_TIME; t += step) {
+      format_face(&new_fields, (time_t)t);
+      checksum += (unsigned char)new_fields.local_time[4] + (unsigned char)new_fields.mjd[8];
+    }
+    elapsed = now_seconds() - start;
+    if (elapsed < best_face) {
+      best_face = elapsed;
+    }
+  }
+
+  printf("strings compared:          %llu for %d zones, every %lld s from 1970 to 2100, "
+         "and every value of the others\n", strings, (int)NUM_ZONES, step);
+  printf("differences:               %d\n", s_failures);
+  printf("ns per update:             %.0f libc, %.0f formatters (in %s)\n",
+         best_libc / (double)((LAST_TIME - FIRST_TIME) / step) * 1e9,
+         best_face / (double)((LAST_TIME - FIRST_TIME) / step) * 1e9, s_zones[NUM_ZONES - 1]);
+  printf("checksum:                  %llu\n", checksum);
+  return(s_failures ? 1 : 0);
+}
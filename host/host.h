@@ -0,0 +1,106 @@
+#pragma once
+
+// The driver-facing side of the host build: the simulated clock, injected
+// messages, and everything the stub SDK counts on the way.
+
+#include "pebble.h"
+
+// What the face cost during a run.
+typedef struct _host_stats {
+  // Wakeups dispatched by the event loop, and the time spent in them.
+  uint64_t wakeups;
+  uint64_t wakeup_ns_total;
+  uint64_t wakeup_ns_max;
+  // Flash traffic, in total and during the event loop only.
+  uint64_t persist_reads;
+  uint64_t persist_writes;
+  uint64_t loop_persist_reads;
+  uint64_t loop_persist_writes;
+  // Display traffic.
+  uint64_t set_text_calls;
+  uint64_t layer_dirty_marks;
+  // Rendering: whole frames, and what went into them.
+  uint64_t frames;
+  uint64_t frame_ns_total;
+  uint64_t frame_ns_max;
+  uint64_t layers_drawn;
+  uint64_t pixels_filled;
+  uint64_t text_draws;
+  // Rows of the display drawn in, and so sent to it, over all the frames.
+  uint64_t rows_sent;
+  // Time spent in the window load handler.
+  uint64_t window_load_ns;
+  // From host_start_launch() to the end of the first frame, and the flash
+  // reads made in between.
+  uint64_t first_frame_ns;
+  uint64_t first_frame_persist_reads;
+  // The same to the end of the first current frame: the one on screen once
+  // everything due at launch (a warm start's catch-up update, say) has run
+  // and been drawn. On a cold start it's the first frame.
+  uint64_t current_frame_ns;
+  uint64_t current_frame_persist_reads;
+  // App heap, and how much was in use when the event loop started.
+  size_t heap_current;
+  size_t heap_peak;
+  size_t heap_at_loop_start;
+  // AppMessage traffic, and the buffer sizes the face asked for. Messages
+  // too big for the inbox are dropped, as they would be on the watch.
+  uint64_t messages_received;
+  uint64_t messages_dropped;
+  uint64_t messages_sent;
+  uint32_t inbox_size;
+  uint32_t outbox_size;
+} HostStats;
+
+// Called with each message the face sends, as the phone would receive it.
+typedef void (*HostOutboxHandler)(const DictionaryIterator *iter);
+
+// Set the simulated clock, in milliseconds since the Unix epoch.
+void host_set_time_ms(int64_t now_ms);
+int64_t host_get_time_ms(void);
+
+// Note that the face is about to be launched, to time its first frame from.
+void host_start_launch(void);
+
+// Save the watch's persistent storage and clock to a file, or restore them
+// from one, so that a later run carries on as a relaunch would. Loading
+// returns false if there's no such file.
+bool host_save_state(const char *path);
+bool host_load_state(const char *path);
+
+// How long app_event_loop() should simulate before returning.
+void host_set_run_length_ms(int64_t run_ms);
+
+// Deliver an AppMessage at the given simulated time. Tuples queued for the
+// same time arrive together, in one message.
+void host_queue_message_int32(int64_t at_ms, uint32_t key, int32_t value);
+void host_queue_message_cstring(int64_t at_ms, uint32_t key, const char *value);
+void host_queue_message_data(int64_t at_ms, uint32_t key, const void *data, uint16_t length);
+
+// Have the face's outgoing messages passed to handler.
+void host_set_outbox_handler(HostOutboxHandler handler);
+
+// Called after each wakeup the event loop dispatches, once the display has
+// been updated, with the simulated time.
+typedef void (*HostWakeupHandler)(int64_t at_ms);
+
+void host_set_wakeup_handler(HostWakeupHandler handler);
+
+// Give a resource its contents, which must outlive the run. Resources not
+// given any don't exist.
+void host_set_resource(uint32_t resource_id, const void *data, size_t size);
+
+// Tap the watch at the given simulated time.
+void host_queue_tap(int64_t at_ms);
+
+// The host's monotonic clock in microseconds, for the face's own timers in
+// builds with INSTRUMENT.
+uint32_t host_clock_us(void);
+
+// The screen size of the platform being simulated.
+void host_set_screen_size(int16_t w, int16_t h);
+
+// Send APP_LOG output to stderr.
+void host_set_logging(bool enabled);
+
+const HostStats *host_get_stats(void);
@@ -0,0 +1,104 @@
+#include "catalogue.h"
+
+// Build the face's CATALOGUE resource from its text form.
+//
+// Usage: mkcatalogue catalogue.txt catalogue.bin
+//
+// Each line of the text is a name, a right ascension as hh:mm:ss, a
+// declination as [+-]dd:mm:ss and an elevation limit in degrees; anything
+// after a # is ignored. The records are written in the watch's byte order,
+// which is the same as the host's on anything we build on.
+
+#define MAX_SOURCES 1024
+
+static catalogueSource s_sources[MAX_SOURCES];
+
+// Parse [+-]a:b:c into a, plus b/60, plus c/3600.
+static int parse_sexagesimal(const char *s, double *value) {
+  double a = 0, b = 0, c = 0;
+  int negative = (*s == '-');
+  if ((*s == '-') || (*s == '+')) {
+    s++;
+  }
+  if (sscanf(s, "%lf:%lf:%lf", &a, &b, &c) < 1) {
+    return(-1);
+  }
+  *value = (a + b / 60 + c / 3600) * (negative ? -1 : 1);
+  return(0);
+}
+
+// Fractions of a turn into 2^-32 turns.
+static uint32_t turns32(double turns) {
+  return((uint32_t)(int64_t)(turns * 4294967296.0));
+}
+
+int main(int argc, char *argv[]) {
+  catalogueHeader header;
+  char line[256];
+  FILE *in, *out;
+  int num_sources = 0, line_number = 0;
+  size_t name_length;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s catalogue.txt catalogue.bin\n", argv[0]);
+    return(1);
+  }
+  if (!(in = fopen(argv[1], "r"))) {
+    perror(argv[1]);
+    return(1);
+  }
+  while (fgets(line, sizeof(line), in)) {
+    char name[64], ra_text[32], dec_text[32];
+    double ra, dec, elevation_limit;
+    char *comment = strchr(line, '#');
+    int n;
+    line_number++;
+    if (comment) {
+      *comment = '\0';
+    }
+    n = sscanf(line, "%63s %31s %31s %lf", name, ra_text, dec_text, &elevation_limit);
+    if (n <= 0) {
+      continue;
+    }
+    if ((n != 4) || (parse_sexagesimal(ra_text, &ra) != 0) ||
+        (parse_sexagesimal(dec_text, &dec) != 0) || (ra < 0) || (ra >= 24) ||
+        (dec < -90) || (dec > 90) || (elevation_limit < -90) || (elevation_limit > 90)) {
+      fprintf(stderr, "%s:%d: can't read this line\n", argv[1], line_number);
+      fclose(in);
+      return(1);
+    }
+    if (num_sources == MAX_SOURCES) {
+      fprintf(stderr, "%s: more than %d sources\n", argv[1], MAX_SOURCES);
+      fclose(in);
+      return(1);
+    }
+    // Names are cut to fit, and padded with NULs.
+    name_length = strlen(name);
+    if (name_length > CATALOGUE_NAME_LENGTH - 1) {
+      name_length = CATALOGUE_NAME_LENGTH - 1;
+    }
+    memset(s_sources[num_sources].name, 0, CATALOGUE_NAME_LENGTH);
+    memcpy(s_sources[num_sources].name, name, name_length);
+    s_sources[num_sources].ra = turns32(ra / 24);
+    s_sources[num_sources].dec = (int32_t)turns32(dec / 360);
+    s_sources[num_sources].elevation_limit = (int32_t)turns32(elevation_limit / 360);
+    num_sources++;
+  }
+  fclose(in);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CATALOGUE_MAGIC, sizeof(header.magic));
+  header.num_sources = (uint16_t)num_sources;
+  header.record_size = sizeof(catalogueSource);
+  if (!(out = fopen(argv[2], "wb")) ||
+      (fwrite(&header, sizeof(header), 1, out) != 1) ||
+      (fwrite(s_sources, sizeof(catalogueSource), (size_t)num_sources, out) !=
+       (size_t)num_sources) ||
+      (fclose(out) != 0)) {
+    perror(argv[2]);
+    return(1);
+  }
+  printf("%s: %d sources, %zu bytes\n", argv[2], num_sources,
+         sizeof(header) + num_sources * sizeof(catalogueSource));
+  return(0);
+}
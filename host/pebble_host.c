@@ -0,0 +1,985 @@
+#include "host.h"
+
+#include <math.h>
+
+// We need the real allocator underneath the tracked one.
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#define MAX_TIMERS 8
+#define MAX_MESSAGES 8
+#define MAX_TUPLES 16
+#define MAX_TUPLE_VALUE 256
+#define MAX_TAPS 32768
+#define MAX_RESOURCES 4
+
+struct Layer {
+  GRect frame;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  LayerUpdateProc update_proc;
+};
+
+struct TextLayer {
+  // Must be first, so the stub renderer can find the text layer again.
+  Layer layer;
+  const char *text;
+  GColor background_colour;
+  GColor text_colour;
+  GFont font;
+  GTextAlignment alignment;
+};
+
+struct Window {
+  Layer root_layer;
+  WindowHandlers handlers;
+  GColor background_colour;
+  bool loaded;
+};
+
+struct AppTimer {
+  bool active;
+  int64_t fire_ms;
+  AppTimerCallback callback;
+  void *data;
+};
+
+// The stub renderer draws into an 8-bit framebuffer, so that the cost of a
+// frame scales with the area it touches as it does on the watch.
+struct GContext {
+  GColor fill_colour;
+  GColor text_colour;
+  GPoint offset;
+};
+
+#define MAX_SCREEN_ROWS 228
+#define MAX_SCREEN_PIXELS (200 * MAX_SCREEN_ROWS)
+
+struct DictionaryIterator {
+  int num_tuples;
+  Tuple *tuples[MAX_TUPLES];
+};
+
+typedef struct _persist_entry {
+  bool used;
+  size_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} persistEntry;
+
+struct ResourceData {
+  const uint8_t *data;
+  size_t size;
+};
+
+typedef struct _queued_tuple {
+  Tuple tuple;
+  uint8_t value[MAX_TUPLE_VALUE];
+} queuedTuple;
+
+typedef struct _queued_message {
+  bool pending;
+  int64_t at_ms;
+  int num_tuples;
+  queuedTuple tuples[MAX_TUPLES];
+} queuedMessage;
+
+static HostStats s_stats;
+static int64_t s_now_ms = 0;
+static int64_t s_run_ms = 24 * 3600 * 1000LL;
+static GSize s_screen = { 144, 168 };
+static bool s_logging = false;
+static bool s_screen_dirty = false;
+static uint8_t s_framebuffer[MAX_SCREEN_PIXELS];
+// The rows drawn in since the last frame went to the display; only those
+// are sent to it.
+static bool s_rows_drawn[MAX_SCREEN_ROWS];
+static Window *s_top_window = NULL;
+static uint64_t s_launch_ns = 0;
+static uint64_t s_launch_persist_reads = 0;
+
+static persistEntry s_persist[64];
+static AppTimer s_timers[MAX_TIMERS];
+static queuedMessage s_messages[MAX_MESSAGES];
+static TickHandler s_tick_handler = NULL;
+static TimeUnits s_tick_units = 0;
+static AppMessageInboxReceived s_inbox_received = NULL;
+static AppMessageInboxDropped s_inbox_dropped = NULL;
+static AccelTapHandler s_tap_handler = NULL;
+static int64_t s_taps[MAX_TAPS];
+static int s_num_taps = 0;
+static int s_next_tap = 0;
+static struct ResourceData s_resources[MAX_RESOURCES];
+static HostOutboxHandler s_outbox_handler = NULL;
+static HostWakeupHandler s_wakeup_handler = NULL;
+static queuedMessage s_outbox;
+static DictionaryIterator s_outbox_iter;
+static bool s_outbox_open = false;
+
+// Tracked heap: each block carries its size in front of it.
+typedef union _heap_header {
+  size_t size;
+  max_align_t align;
+} heapHeader;
+
+void *host_malloc(size_t size) {
+  heapHeader *h = malloc(sizeof(heapHeader) + size);
+  if (!h) {
+    return(NULL);
+  }
+  h->size = size;
+  s_stats.heap_current += size;
+  if (s_stats.heap_current > s_stats.heap_peak) {
+    s_stats.heap_peak = s_stats.heap_current;
+  }
+  return(h + 1);
+}
+
+void *host_calloc(size_t count, size_t size) {
+  void *p = host_malloc(count * size);
+  if (p) {
+    memset(p, 0, count * size);
+  }
+  return(p);
+}
+
+void host_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  heapHeader *h = (heapHeader *)ptr - 1;
+  s_stats.heap_current -= h->size;
+  free(h);
+}
+
+void *host_realloc(void *ptr, size_t size) {
+  void *p = host_malloc(size);
+  if (ptr && p) {
+    heapHeader *h = (heapHeader *)ptr - 1;
+    memcpy(p, ptr, (h->size < size) ? h->size : size);
+  }
+  host_free(ptr);
+  return(p);
+}
+
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// The driver's controls.
+
+void host_set_time_ms(int64_t now_ms) {
+  s_now_ms = now_ms;
+}
+
+int64_t host_get_time_ms(void) {
+  return(s_now_ms);
+}
+
+void host_set_run_length_ms(int64_t run_ms) {
+  s_run_ms = run_ms;
+}
+
+// Find room for another tuple in the message arriving at at_ms.
+static Tuple *queue_tuple(int64_t at_ms, uint32_t key, uint8_t type, uint16_t length) {
+  queuedMessage *message = NULL;
+  Tuple *tuple;
+  int i;
+  for (i = 0; i < MAX_MESSAGES; i++) {
+    if (s_messages[i].pending && (s_messages[i].at_ms == at_ms)) {
+      message = &s_messages[i];
+      break;
+    }
+  }
+  for (i = 0; !message && (i < MAX_MESSAGES); i++) {
+    if (!s_messages[i].pending) {
+      message = &s_messages[i];
+      message->pending = true;
+      message->at_ms = at_ms;
+      message->num_tuples = 0;
+    }
+  }
+  if (!message || (message->num_tuples == MAX_TUPLES) || (length > MAX_TUPLE_VALUE)) {
+    return(NULL);
+  }
+  tuple = &message->tuples[message->num_tuples++].tuple;
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  return(tuple);
+}
+
+void host_queue_message_int32(int64_t at_ms, uint32_t key, int32_t value) {
+  Tuple *tuple = queue_tuple(at_ms, key, TUPLE_INT, sizeof(int32_t));
+  if (tuple) {
+    tuple->value->int32 = value;
+  }
+}
+
+void host_queue_message_cstring(int64_t at_ms, uint32_t key, const char *value) {
+  size_t length = strlen(value) + 1;
+  Tuple *tuple = queue_tuple(at_ms, key, TUPLE_CSTRING,
+                             (uint16_t)((length < MAX_TUPLE_VALUE) ? length : MAX_TUPLE_VALUE));
+  if (tuple) {
+    char *cstring = (char *)tuple->value;
+    memcpy(cstring, value, tuple->length);
+    cstring[tuple->length - 1] = '\0';
+  }
+}
+
+void host_queue_message_data(int64_t at_ms, uint32_t key, const void *data, uint16_t length) {
+  Tuple *tuple = queue_tuple(at_ms, key, TUPLE_BYTE_ARRAY, length);
+  if (tuple) {
+    memcpy(tuple->value->data, data, length);
+  }
+}
+
+void host_set_outbox_handler(HostOutboxHandler handler) {
+  s_outbox_handler = handler;
+}
+
+void host_set_wakeup_handler(HostWakeupHandler handler) {
+  s_wakeup_handler = handler;
+}
+
+void host_set_resource(uint32_t resource_id, const void *data, size_t size) {
+  if (resource_id < MAX_RESOURCES) {
+    s_resources[resource_id].data = data;
+    s_resources[resource_id].size = size;
+  }
+}
+
+uint32_t host_clock_us(void) {
+  return((uint32_t)(monotonic_ns() / 1000));
+}
+
+void host_start_launch(void) {
+  s_launch_persist_reads = s_stats.persist_reads;
+  s_launch_ns = monotonic_ns();
+}
+
+bool host_save_state(const char *path) {
+  FILE *f = fopen(path, "wb");
+  bool ok;
+  if (!f) {
+    return(false);
+  }
+  ok = (fwrite(&s_now_ms, sizeof(s_now_ms), 1, f) == 1) &&
+       (fwrite(s_persist, sizeof(s_persist), 1, f) == 1);
+  return((fclose(f) == 0) && ok);
+}
+
+bool host_load_state(const char *path) {
+  FILE *f = fopen(path, "rb");
+  bool ok;
+  if (!f) {
+    return(false);
+  }
+  ok = (fread(&s_now_ms, sizeof(s_now_ms), 1, f) == 1) &&
+       (fread(s_persist, sizeof(s_persist), 1, f) == 1);
+  fclose(f);
+  return(ok);
+}
+
+// Taps are kept in time order, so the event loop only looks at the next.
+void host_queue_tap(int64_t at_ms) {
+  int i;
+  if (s_num_taps < MAX_TAPS) {
+    for (i = s_num_taps++; (i > 0) && (s_taps[i - 1] > at_ms); i--) {
+      s_taps[i] = s_taps[i - 1];
+    }
+    s_taps[i] = at_ms;
+  }
+}
+
+void host_set_screen_size(int16_t w, int16_t h) {
+  s_screen = GSize(w, h);
+}
+
+void host_set_logging(bool enabled) {
+  s_logging = enabled;
+}
+
+const HostStats *host_get_stats(void) {
+  return(&s_stats);
+}
+
+// Logging.
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+             const char *fmt, ...) {
+  if (!s_logging) {
+    return;
+  }
+  va_list ap;
+  va_start(ap, fmt);
+  fprintf(stderr, "[%d] %s:%d ", log_level, src_filename, src_line_number);
+  vfprintf(stderr, fmt, ap);
+  fputc('\n', stderr);
+  va_end(ap);
+}
+
+// Time.
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  uint16_t ms = (uint16_t)(s_now_ms % 1000);
+  if (tloc) {
+    *tloc = (time_t)(s_now_ms / 1000);
+  }
+  if (out_ms) {
+    *out_ms = ms;
+  }
+  return(ms);
+}
+
+// Graphics and layers.
+
+GFont fonts_get_system_font(const char *font_key) {
+  return((GFont)font_key);
+}
+
+Layer *layer_create(GRect frame) {
+  Layer *layer = host_calloc(1, sizeof(Layer));
+  layer->frame = frame;
+  return(layer);
+}
+
+void layer_destroy(Layer *layer) {
+  host_free(layer);
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  Layer **last = &parent->first_child;
+  while (*last) {
+    last = &(*last)->next_sibling;
+  }
+  *last = child;
+  child->parent = parent;
+  s_screen_dirty = true;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return(GRect(0, 0, layer->frame.size.w, layer->frame.size.h));
+}
+
+void layer_mark_dirty(Layer *layer) {
+  (void)layer;
+  s_stats.layer_dirty_marks++;
+  // As on the watch, any dirty layer means the whole window is redrawn.
+  s_screen_dirty = true;
+}
+
+// Graphics.
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_colour = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_colour = color;
+}
+
+static void fill_pixels(GContext *ctx, GRect rect, uint8_t value) {
+  int16_t x0 = rect.origin.x + ctx->offset.x;
+  int16_t y0 = rect.origin.y + ctx->offset.y;
+  int16_t x1 = x0 + rect.size.w;
+  int16_t y1 = y0 + rect.size.h;
+  int16_t y;
+  if (x0 < 0) {
+    x0 = 0;
+  }
+  if (y0 < 0) {
+    y0 = 0;
+  }
+  if (x1 > s_screen.w) {
+    x1 = s_screen.w;
+  }
+  if (y1 > s_screen.h) {
+    y1 = s_screen.h;
+  }
+  for (y = y0; y < y1; y++) {
+    memset(&s_framebuffer[y * s_screen.w + x0], value, (x1 > x0) ? x1 - x0 : 0);
+    s_stats.pixels_filled += (x1 > x0) ? x1 - x0 : 0;
+    s_rows_drawn[y] = true;
+  }
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  // Corners are drawn square.
+  (void)corner_radius;
+  (void)corner_mask;
+  if (ctx->fill_colour.argb != GColorClear.argb) {
+    fill_pixels(ctx, rect, ctx->fill_colour.argb);
+  }
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        GTextAttributes *text_attributes) {
+  // Fonts are named by their key, which carries the pixel height. Each glyph
+  // is drawn as a box about half as wide as it is high.
+  const char *key = (const char *)font;
+  int16_t height = 14;
+  int16_t width, x;
+  size_t n, i;
+  (void)overflow_mode;
+  (void)text_attributes;
+  s_stats.text_draws++;
+  if (!text) {
+    return;
+  }
+  while (*key && ((*key < '0') || (*key > '9'))) {
+    key++;
+  }
+  if (*key) {
+    height = (int16_t)atoi(key);
+  }
+  n = strlen(text);
+  width = (int16_t)(n * height / 2);
+  x = box.origin.x;
+  if (alignment == GTextAlignmentCenter) {
+    x += (box.size.w - width) / 2;
+  } else if (alignment == GTextAlignmentRight) {
+    x += box.size.w - width;
+  }
+  for (i = 0; i < n; i++) {
+    if (text[i] != ' ') {
+      fill_pixels(ctx, GRect(x + i * height / 2, box.origin.y, height / 2 - 1, height),
+                  ctx->text_colour.argb);
+    }
+  }
+}
+
+// Draw a layer and its children, the way the compositor would.
+static void render_layer(Layer *layer, GContext *ctx) {
+  GPoint saved = ctx->offset;
+  Layer *child;
+  ctx->offset.x += layer->frame.origin.x;
+  ctx->offset.y += layer->frame.origin.y;
+  s_stats.layers_drawn++;
+  if (layer->update_proc) {
+    layer->update_proc(layer, ctx);
+  }
+  for (child = layer->first_child; child; child = child->next_sibling) {
+    render_layer(child, ctx);
+  }
+  ctx->offset = saved;
+}
+
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+  TextLayer *text_layer = (TextLayer *)layer;
+  GRect bounds = layer_get_bounds(layer);
+  graphics_context_set_fill_color(ctx, text_layer->background_colour);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  graphics_context_set_text_color(ctx, text_layer->text_colour);
+  graphics_draw_text(ctx, text_layer->text, text_layer->font, bounds,
+                     GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+}
+
+// Draw a whole frame if anything is dirty. As on the watch, the framebuffer
+// keeps the last frame, and the window's background only covers it if the
+// background isn't clear.
+static void render_frame(void) {
+  int16_t y;
+  if (!s_screen_dirty || !s_top_window) {
+    return;
+  }
+  GContext ctx = { GColorBlack, GColorBlack, GPoint(0, 0) };
+  uint64_t start_ns = monotonic_ns();
+  if (s_top_window->background_colour.argb != GColorClear.argb) {
+    memset(s_framebuffer, s_top_window->background_colour.argb, s_screen.w * s_screen.h);
+    memset(s_rows_drawn, true, s_screen.h);
+  }
+  render_layer(window_get_root_layer(s_top_window), &ctx);
+  uint64_t elapsed_ns = monotonic_ns() - start_ns;
+  for (y = 0; y < s_screen.h; y++) {
+    s_stats.rows_sent += s_rows_drawn[y];
+    s_rows_drawn[y] = false;
+  }
+  s_screen_dirty = false;
+  if ((s_stats.frames == 0) && s_launch_ns) {
+    s_stats.first_frame_ns = monotonic_ns() - s_launch_ns;
+    s_stats.first_frame_persist_reads = s_stats.persist_reads - s_launch_persist_reads;
+  }
+  s_stats.frames++;
+  s_stats.frame_ns_total += elapsed_ns;
+  if (elapsed_ns > s_stats.frame_ns_max) {
+    s_stats.frame_ns_max = elapsed_ns;
+  }
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = host_calloc(1, sizeof(TextLayer));
+  text_layer->layer.frame = frame;
+  text_layer->layer.update_proc = text_layer_update_proc;
+  text_layer->background_colour = GColorWhite;
+  text_layer->text_colour = GColorBlack;
+  return(text_layer);
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  host_free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return(&text_layer->layer);
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  s_stats.set_text_calls++;
+  text_layer->text = text;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_colour = color;
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  text_layer->text_colour = color;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  text_layer->font = font;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+  text_layer->alignment = text_alignment;
+}
+
+Window *window_create(void) {
+  Window *window = host_calloc(1, sizeof(Window));
+  window->root_layer.frame = GRect(0, 0, s_screen.w, s_screen.h);
+  window->background_colour = GColorWhite;
+  return(window);
+}
+
+void window_destroy(Window *window) {
+  if (window->loaded && window->handlers.unload) {
+    window->handlers.unload(window);
+  }
+  if (s_top_window == window) {
+    s_top_window = NULL;
+  }
+  host_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return((Layer *)&window->root_layer);
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  window->background_colour = background_color;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  (void)animated;
+  s_top_window = window;
+  s_screen_dirty = true;
+  if (!window->loaded && window->handlers.load) {
+    uint64_t start_ns = monotonic_ns();
+    window->handlers.load(window);
+    s_stats.window_load_ns = monotonic_ns() - start_ns;
+  }
+  window->loaded = true;
+  if (window->handlers.appear) {
+    window->handlers.appear(window);
+  }
+}
+
+// Persistent storage, held in memory.
+
+bool persist_exists(const uint32_t key) {
+  s_stats.persist_reads++;
+  return((key < 64) && s_persist[key].used);
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  s_stats.persist_reads++;
+  if ((key >= 64) || !s_persist[key].used) {
+    return(-1);
+  }
+  size_t n = (s_persist[key].size < buffer_size) ? s_persist[key].size : buffer_size;
+  memcpy(buffer, s_persist[key].data, n);
+  return((int)n);
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return(value);
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  s_stats.persist_writes++;
+  if ((key >= 64) || (size > PERSIST_DATA_MAX_LENGTH)) {
+    return(-1);
+  }
+  s_persist[key].used = true;
+  s_persist[key].size = size;
+  memcpy(s_persist[key].data, data, size);
+  return((int)size);
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  return(persist_write_data(key, &value, sizeof(value)));
+}
+
+int persist_delete(const uint32_t key) {
+  s_stats.persist_writes++;
+  if (key < 64) {
+    s_persist[key].used = false;
+  }
+  return(0);
+}
+
+// Tick timer service.
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  s_tick_units = tick_units;
+  s_tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+  s_tick_handler = NULL;
+}
+
+// Accelerometer taps.
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  s_tap_handler = NULL;
+}
+
+// Trigonometry, done in floating point: the face only cares that the
+// results are as good as the watch's tables.
+
+static double angle_radians(int32_t angle) {
+  return((double)angle * 2 * M_PI / TRIG_MAX_ANGLE);
+}
+
+int32_t sin_lookup(int32_t angle) {
+  return((int32_t)lround(sin(angle_radians(angle)) * TRIG_MAX_RATIO));
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return((int32_t)lround(cos(angle_radians(angle)) * TRIG_MAX_RATIO));
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+  double turns = atan2(y, x) / (2 * M_PI);
+  int32_t angle = (int32_t)lround(((turns < 0) ? turns + 1 : turns) * TRIG_MAX_ANGLE);
+  return((angle >= TRIG_MAX_ANGLE) ? 0 : angle);
+}
+
+// Resources.
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+  if ((resource_id >= MAX_RESOURCES) || !s_resources[resource_id].data) {
+    return(NULL);
+  }
+  return(&s_resources[resource_id]);
+}
+
+size_t resource_size(ResHandle h) {
+  return(h ? h->size : 0);
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer,
+                                size_t num_bytes) {
+  if (!h || (start_offset >= h->size)) {
+    return(0);
+  }
+  if (num_bytes > h->size - start_offset) {
+    num_bytes = h->size - start_offset;
+  }
+  memcpy(buffer, h->data + start_offset, num_bytes);
+  return(num_bytes);
+}
+
+// App timers.
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  int i;
+  for (i = 0; i < MAX_TIMERS; i++) {
+    if (!s_timers[i].active) {
+      s_timers[i] = (AppTimer){ true, s_now_ms + timeout_ms, callback, callback_data };
+      return(&s_timers[i]);
+    }
+  }
+  return(NULL);
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  if (!timer_handle->active) {
+    return(false);
+  }
+  timer_handle->fire_ms = s_now_ms + new_timeout_ms;
+  return(true);
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  timer_handle->active = false;
+}
+
+// App messages.
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  int i;
+  for (i = 0; i < iter->num_tuples; i++) {
+    if (iter->tuples[i]->key == key) {
+      return(iter->tuples[i]);
+    }
+  }
+  return(NULL);
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  s_inbox_received = received_callback;
+}
+
+void app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+  s_inbox_dropped = dropped_callback;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  // The real buffers come out of the app heap.
+  host_malloc(size_inbound);
+  host_malloc(size_outbound);
+  s_stats.inbox_size = size_inbound;
+  s_stats.outbox_size = size_outbound;
+  return(APP_MSG_OK);
+}
+
+// The on-the-wire size of a dictionary: a count, then each tuple's 7-byte
+// header and value.
+#define DICT_HEADER_SIZE 1
+#define TUPLE_HEADER_SIZE 7
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  uint32_t size = DICT_HEADER_SIZE;
+  va_list ap;
+  int i;
+  va_start(ap, tuple_count);
+  for (i = 0; i < tuple_count; i++) {
+    size += TUPLE_HEADER_SIZE + va_arg(ap, unsigned int);
+  }
+  va_end(ap);
+  return(size);
+}
+
+static uint32_t message_size(const queuedMessage *message) {
+  uint32_t size = DICT_HEADER_SIZE;
+  int i;
+  for (i = 0; i < message->num_tuples; i++) {
+    size += TUPLE_HEADER_SIZE + message->tuples[i].tuple.length;
+  }
+  return(size);
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (s_outbox_open || (s_stats.outbox_size == 0)) {
+    return(APP_MSG_BUSY);
+  }
+  s_outbox_open = true;
+  s_outbox.num_tuples = 0;
+  s_outbox_iter.num_tuples = 0;
+  *iterator = &s_outbox_iter;
+  return(APP_MSG_OK);
+}
+
+// Add a tuple to the outbox, if there's room for it.
+static Tuple *write_tuple(DictionaryIterator *iter, uint32_t key, uint8_t type, uint16_t length,
+                          DictionaryResult *result) {
+  Tuple *tuple;
+  if ((iter != &s_outbox_iter) || (s_outbox.num_tuples == MAX_TUPLES) ||
+      (length > MAX_TUPLE_VALUE)) {
+    *result = DICT_INVALID_ARGS;
+    return(NULL);
+  }
+  if (message_size(&s_outbox) + TUPLE_HEADER_SIZE + length > s_stats.outbox_size) {
+    *result = DICT_NOT_ENOUGH_STORAGE;
+    return(NULL);
+  }
+  tuple = &s_outbox.tuples[s_outbox.num_tuples].tuple;
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  s_outbox_iter.tuples[s_outbox_iter.num_tuples++] = tuple;
+  s_outbox.num_tuples++;
+  *result = DICT_OK;
+  return(tuple);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+  DictionaryResult result;
+  Tuple *tuple = write_tuple(iter, key, TUPLE_INT, sizeof(int32_t), &result);
+  if (tuple) {
+    tuple->value->int32 = value;
+  }
+  return(result);
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *data,
+                                 const uint16_t size) {
+  DictionaryResult result;
+  Tuple *tuple = write_tuple(iter, key, TUPLE_BYTE_ARRAY, size, &result);
+  if (tuple) {
+    memcpy(tuple->value->data, data, size);
+  }
+  return(result);
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  if (!s_outbox_open) {
+    return(APP_MSG_INVALID_ARGS);
+  }
+  // The phone gets it straight away; it's up to the driver to answer later.
+  s_outbox_open = false;
+  s_stats.messages_sent++;
+  if (s_outbox_handler) {
+    s_outbox_handler(&s_outbox_iter);
+  }
+  return(APP_MSG_OK);
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return(8200);
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return(8200);
+}
+
+// The event loop. Rather than sleeping, we jump the simulated clock straight
+// to the next thing that would wake the app, so a day runs in moments.
+
+static int64_t next_tick_ms(void) {
+  int64_t unit_ms = (s_tick_units & SECOND_UNIT) ? 1000 : 60000;
+  return((s_now_ms / unit_ms + 1) * unit_ms);
+}
+
+static void dispatch_message(queuedMessage *queued) {
+  // Take a copy, so the driver can queue more from the outbox handler.
+  static queuedMessage message_copy;
+  queuedMessage *message = &message_copy;
+  DictionaryIterator iter;
+  int i;
+  *message = *queued;
+  queued->pending = false;
+  iter.num_tuples = message->num_tuples;
+  for (i = 0; i < message->num_tuples; i++) {
+    iter.tuples[i] = &message->tuples[i].tuple;
+  }
+  if (message_size(message) > s_stats.inbox_size) {
+    s_stats.messages_dropped++;
+    if (s_inbox_dropped) {
+      s_inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+    }
+    return;
+  }
+  s_stats.messages_received++;
+  if (s_inbox_received) {
+    s_inbox_received(&iter, NULL);
+  }
+}
+
+// Note the current frame, once there's nothing more due at launch.
+static void note_current_frame(void) {
+  if (s_launch_ns && !s_stats.current_frame_ns) {
+    s_stats.current_frame_ns = monotonic_ns() - s_launch_ns;
+    s_stats.current_frame_persist_reads = s_stats.persist_reads - s_launch_persist_reads;
+  }
+}
+
+void app_event_loop(void) {
+  int64_t end_ms = s_now_ms + s_run_ms, launch_ms;
+  s_stats.loop_persist_reads = s_stats.persist_reads;
+  s_stats.loop_persist_writes = s_stats.persist_writes;
+  s_stats.heap_at_loop_start = s_stats.heap_current;
+  render_frame();
+  launch_ms = s_now_ms;
+
+  for (;;) {
+    // Find the earliest event.
+    int64_t next_ms = s_tick_handler ? next_tick_ms() : INT64_MAX;
+    AppTimer *timer = NULL;
+    queuedMessage *message = NULL;
+    int64_t *tap = NULL;
+    int i;
+    for (i = 0; i < MAX_TIMERS; i++) {
+      if (s_timers[i].active && (s_timers[i].fire_ms < next_ms)) {
+        next_ms = s_timers[i].fire_ms;
+        timer = &s_timers[i];
+      }
+    }
+    for (i = 0; i < MAX_MESSAGES; i++) {
+      if (s_messages[i].pending && (s_messages[i].at_ms < next_ms)) {
+        next_ms = s_messages[i].at_ms;
+        message = &s_messages[i];
+        timer = NULL;
+      }
+    }
+    if (s_tap_handler && (s_next_tap < s_num_taps) && (s_taps[s_next_tap] < next_ms)) {
+      next_ms = s_taps[s_next_tap];
+      tap = &s_taps[s_next_tap];
+      message = NULL;
+      timer = NULL;
+    }
+    if (next_ms > launch_ms) {
+      note_current_frame();
+    }
+    if (next_ms >= end_ms) {
+      break;
+    }
+    if (next_ms > s_now_ms) {
+      s_now_ms = next_ms;
+    }
+
+    uint64_t start_ns = monotonic_ns();
+    if (tap) {
+      s_next_tap++;
+      s_tap_handler(ACCEL_AXIS_X, 1);
+    } else if (message) {
+      dispatch_message(message);
+    } else if (timer) {
+      timer->active = false;
+      timer->callback(timer->data);
+    } else {
+      time_t now = (time_t)(s_now_ms / 1000);
+      struct tm tick_time;
+      localtime_r(&now, &tick_time);
+      s_tick_handler(&tick_time, s_tick_units);
+    }
+    uint64_t elapsed_ns = monotonic_ns() - start_ns;
+
+    s_stats.wakeups++;
+    s_stats.wakeup_ns_total += elapsed_ns;
+    if (elapsed_ns > s_stats.wakeup_ns_max) {
+      s_stats.wakeup_ns_max = elapsed_ns;
+    }
+    render_frame();
+    if (s_wakeup_handler) {
+      s_wakeup_handler(s_now_ms);
+    }
+  }
+
+  s_now_ms = end_ms;
+  s_stats.loop_persist_reads = s_stats.persist_reads - s_stats.loop_persist_reads;
+  s_stats.loop_persist_writes = s_stats.persist_writes - s_stats.loop_persist_writes;
+}
@@ -0,0 +1,230 @@
+#include "sidereal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Check the sidereal engine the watch runs against golden values, then
+// measure how many timestamps per second it converts: one at a time through
+// sidereal_mjd and sidereal_gmst, as a host tool would without the batch
+// API; stepping through the seconds from an anchor, as the watch does; and
+// through sidereal_batch. Built twice by the Makefile, as siderealbench with
+// the batch loops vectorised and siderealbench-scalar with them not.
+//
+// Usage: siderealbench [timestamps] [repeats]
+//
+// Exits non-zero if any check fails.
+
+#define TURNS_TO_SECONDS (86400.0L / 18446744073709551616.0L)
+
+// A time the watch's numbers are pinned at: its MJD, and the exact GMST it
+// shows in the default SIDEREAL_IAU1982 tier. Any change to the engine that
+// moves one of these changes the face.
+typedef struct _golden {
+  int64_t t;
+  int32_t mjd;
+  turns_t gmst;
+} golden;
+
+static const golden s_golden[] = {
+  // 1883-06-01, near the start of the range the engine works over.
+  { -2732400000LL, 8962, 0xb12920ac31f1db23ULL },
+  // The Unix epoch, and the last second before it.
+  { 0LL, 40587, 0x47463fa5b53b7300ULL },
+  { -1LL, 40586, 0x47457cef698113e7ULL },
+  // J2000.0 (2000-01-01 12:00 UT).
+  { 946728000LL, 51544, 0xc7704c26611c2fc9ULL },
+  // Meeus, Astronomical Algorithms, examples 12.a and 12.b.
+  { 545011200LL, 46895, 0x8c94f2a7ec05d490ULL },
+  { 545080860LL, 46895, 0x5b8c03be69cff944ULL },
+  // The bench's start, and the last second of a leap day.
+  { 1792108812LL, 61329, 0x117a2fa7299f01f2ULL },
+  { 1709251199LL, 60369, 0x71455df13d32bf03ULL },
+  // 2117-01-01, near the end of the range.
+  { 4638902400LL, 94278, 0x478dd5eddb86981fULL },
+};
+
+#define NUM_GOLDEN (sizeof(s_golden) / sizeof(s_golden[0]))
+
+// The IAU 1982 expression for GMST, in seconds of sidereal time into the
+// day, in long double arithmetic.
+static long double reference_gmst(int64_t t) {
+  long double days = floorl((long double)t / 86400.0L);
+  long double ut = (long double)t - days * 86400.0L;
+  long double t0 = (days + MJD_UNIX_EPOCH - 51544.5L) / 36525.0L;
+  long double gmst = 24110.54841L + t0 * (8640184.812866L + t0 * (0.093104L - t0 * 6.2e-6L)) +
+                     1.002737909350795L * ut;
+  return(fmodl(fmodl(gmst, 86400.0L) + 86400.0L, 86400.0L));
+}
+
+// The difference between a GMST in turns and one in seconds, in seconds.
+static double gmst_error(turns_t gmst, long double seconds) {
+  long double d = (long double)gmst * TURNS_TO_SECONDS - seconds;
+  if (d > 43200.0L) {
+    d -= 86400.0L;
+  } else if (d < -43200.0L) {
+    d += 86400.0L;
+  }
+  return((double)d);
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+}
+
+// Keep the quickest of several runs, started at start.
+static void keep_best(double *best, double start) {
+  double elapsed = now_seconds() - start;
+  if (elapsed < *best) {
+    *best = elapsed;
+  }
+}
+
+// A fast, repeatable stream of pseudo-random numbers.
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return(*state);
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = (argc > 1) ? (size_t)atol(argv[1]) : 1 << 20;
+  int repeats = (argc > 2) ? atoi(argv[2]) : 20;
+  // Meeus gives 13h10m46.3668s and 8h34m57.0896s for examples 12.a and b.
+  static const long double meeus[2] = { 47446.3668L, 30897.0896L };
+  int64_t first = -2732400000LL, last = 4638902400LL;
+  int64_t *t = malloc(n * sizeof(*t));
+  int32_t *longitude_e7 = malloc(n * sizeof(*longitude_e7));
+  int32_t *mjd = malloc(n * sizeof(*mjd));
+  turns_t *gmst = malloc(n * sizeof(*gmst));
+  turns_t *lst = malloc(n * sizeof(*lst));
+  double worst = 0, best_scalar = 1e30, best_anchor = 1e30, best_batch = 1e30, start;
+  uint64_t state = 0x9e3779b97f4a7c15ULL, checksum = 0;
+  siderealAnchor anchor = { false, 0, 0 };
+  int failures = 0, r;
+  size_t i;
+
+  if (!t || !longitude_e7 || !mjd || !gmst || !lst || (n == 0) || (repeats < 1)) {
+    fprintf(stderr, "usage: %s [timestamps] [repeats]\n", argv[0]);
+    return(1);
+  }
+
+  // The golden values, through every path in to the engine.
+  for (i = 0; i < NUM_GOLDEN; i++) {
+    const golden *g = &s_golden[i];
+    int32_t day_seconds, day = sidereal_mjd(g->t, &day_seconds);
+    turns_t scalar = sidereal_gmst(day, day_seconds);
+    turns_t stepped = sidereal_time2gmst(&anchor, g->t, 0, NULL, NULL);
+    int32_t batch_mjd;
+    turns_t batch_gmst;
+    sidereal_batch(&g->t, NULL, 1, &batch_mjd, &batch_gmst, NULL);
+    if ((day != g->mjd) || (scalar != g->gmst) || (stepped != g->gmst) ||
+        (batch_mjd != g->mjd) || (batch_gmst != g->gmst)) {
+      printf("golden %lld: MJD %d, GMST %016llx, stepped %016llx, batch %d %016llx; "
+             "expected %d %016llx\n", (long long)g->t, day, (unsigned long long)scalar,
+             (unsigned long long)stepped, batch_mjd, (unsigned long long)batch_gmst, g->mjd,
+             (unsigned long long)g->gmst);
+      failures++;
+    }
+  }
+  // A minute and a second are whole fractions of the day, rounded down, and
+  // each rolls over within the resolution of what the face shows.
+  if ((SIDEREAL_MINUTE != UINT64_MAX / 1440) || (SIDEREAL_SECOND != UINT64_MAX / 86400) ||
+      (SIDEREAL_MINUTE < 60 * SIDEREAL_SECOND) || (SIDEREAL_MINUTE >= 60 * SIDEREAL_SECOND + 60)) {
+    printf("SIDEREAL_MINUTE %llu and SIDEREAL_SECOND %llu aren't 1/1440 and 1/86400 turn\n",
+           (unsigned long long)SIDEREAL_MINUTE, (unsigned long long)SIDEREAL_SECOND);
+    failures++;
+  }
+  for (i = 1; i < 1440; i++) {
+    turns_t rollover = (turns_t)i * SIDEREAL_MINUTE;
+    if ((sidereal_minutes(rollover - (1 << 17)) != (int)i - 1) ||
+        (sidereal_minutes(rollover + (1 << 17)) != (int)i)) {
+      if (failures++ < 10) {
+        printf("minute %d doesn't roll over at %d * SIDEREAL_MINUTE\n", (int)i, (int)i);
+      }
+    }
+  }
+  for (i = 1; i < 86400; i++) {
+    turns_t rollover = (turns_t)i * SIDEREAL_SECOND;
+    if ((sidereal_seconds(rollover - (1 << 21)) != (int32_t)i - 1) ||
+        (sidereal_seconds(rollover + (1 << 21)) != (int32_t)i)) {
+      if (failures++ < 10) {
+        printf("second %d doesn't roll over at %d * SIDEREAL_SECOND\n", (int)i, (int)i);
+      }
+    }
+  }
+  for (i = 0; i < 2; i++) {
+    double error = gmst_error(s_golden[4 + i].gmst, meeus[i]);
+    if (fabs(error) > 1e-3) {
+      printf("Meeus example 12.%c: off by %.4f s\n", (int)('a' + i), error);
+      failures++;
+    }
+  }
+
+  // Times spread over the whole range, with both ends, against the
+  // reference and one at a time.
+  for (i = 0; i < n; i++) {
+    t[i] = first + (int64_t)(next_random(&state) % (uint64_t)(last - first));
+    longitude_e7[i] = (int32_t)(next_random(&state) % 3600000001ULL) - 1800000000;
+  }
+  t[0] = first;
+  t[n - 1] = last;
+  sidereal_batch(t, longitude_e7, n, mjd, gmst, lst);
+  for (i = 0; i < n; i++) {
+    int32_t day_seconds, day = sidereal_mjd(t[i], &day_seconds);
+    turns_t scalar = sidereal_gmst(day, day_seconds);
+    double error = gmst_error(scalar, reference_gmst(t[i]));
+    if (fabs(error) > fabs(worst)) {
+      worst = error;
+    }
+    if ((mjd[i] != day) || (gmst[i] != scalar) ||
+        (lst[i] != scalar + sidereal_longitude(longitude_e7[i]))) {
+      if (failures++ < 10) {
+        printf("batch differs at %lld\n", (long long)t[i]);
+      }
+    }
+  }
+  if (fabs(worst) > 1e-4) {
+    failures++;
+  }
+
+  for (r = 0; r < repeats; r++) {
+    start = now_seconds();
+    for (i = 0; i < n; i++) {
+      int32_t day_seconds, day = sidereal_mjd(t[i], &day_seconds);
+      checksum += sidereal_gmst(day, day_seconds) + sidereal_longitude(longitude_e7[i]) + day;
+    }
+    keep_best(&best_scalar, start);
+
+    // The watch's way: successive seconds from the time of the first.
+    start = now_seconds();
+    for (i = 0; i < n; i++) {
+      checksum += sidereal_time2gmst(&anchor, t[0] + (int64_t)i, 0, NULL, NULL);
+    }
+    keep_best(&best_anchor, start);
+
+    start = now_seconds();
+    sidereal_batch(t, longitude_e7, n, mjd, gmst, lst);
+    keep_best(&best_batch, start);
+    checksum += lst[r % n];
+  }
+
+  printf("checks failed:             %d (%d golden times, %zu against the reference)\n",
+         failures, (int)NUM_GOLDEN, n);
+  printf("worst error vs IAU 1982:   %.2e s over %zu times from 1883 to 2117\n", worst, n);
+  printf("one at a time:             %.1f million per second\n", n / best_scalar / 1e6);
+  printf("stepped, as the watch:     %.1f million per second\n", n / best_anchor / 1e6);
+  printf("sidereal_batch:            %.1f million per second (%.1fx)\n", n / best_batch / 1e6,
+         best_scalar / best_batch);
+  printf("checksum:                  %016llx\n", (unsigned long long)checksum);
+  free(t);
+  free(longitude_e7);
+  free(mjd);
+  free(gmst);
+  free(lst);
+  return(failures ? 1 : 0);
+}
@@ -0,0 +1,153 @@
+#include "sidereal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// What each precision tier of the sidereal engine costs, and what it buys.
+// Built once per tier by the Makefile (tierbench-iau1982, tierbench-era and
+// tierbench-era-dut1), it reports the error in GMST against the full IAU
+// 2006 expression evaluated from UT1 in long double arithmetic, and the
+// cycles each evaluation takes: from scratch, for a time on a new day, and
+// stepped on from the day's anchor, as the watch does every update.
+//
+// Usage: tierbench [dUT1 in seconds] [times]
+//
+// The true dUT1 is taken to be the one given (-0.25 s by default); only the
+// SIDEREAL_ERA_DUT1 tier is told it.
+
+#define TURNS_TO_SECONDS (86400.0L / 18446744073709551616.0L)
+// TT - UTC, with 37 leap seconds, for the precession's century count.
+#define TT_MINUS_UTC 69.184L
+
+#if SIDEREAL_PRECISION == SIDEREAL_IAU1982
+#define TIER_NAME "SIDEREAL_IAU1982"
+#elif SIDEREAL_PRECISION == SIDEREAL_ERA
+#define TIER_NAME "SIDEREAL_ERA"
+#else
+#define TIER_NAME "SIDEREAL_ERA_DUT1"
+#endif
+
+// GMST at t seconds (and ms) after the Unix epoch, in seconds of sidereal
+// time into the day: the Earth Rotation Angle at UT1 plus the IAU 2006
+// precession in right ascension at TT.
+static long double reference_gmst(int64_t t, int ms, long double dut1) {
+  long double days = floorl((long double)t / 86400.0L);
+  long double ut1 = (long double)t - days * 86400.0L + ms / 1000.0L + dut1;
+  long double du = days + MJD_UNIX_EPOCH - 51544.5L;
+  long double c = (du + (ut1 - dut1 + TT_MINUS_UTC) / 86400.0L) / 36525.0L;
+  long double era = 0.7790572732640L + 0.00273781191135448L * (du + ut1 / 86400.0L) +
+                    fmodl(du, 1.0L) + ut1 / 86400.0L;
+  long double precession = 0.014506L + c * (4612.156534L + c * (1.3915817L + c * (-0.00000044L +
+                           c * (-0.000029956L + c * -0.0000000368L))));
+  long double turns = era + precession / 1296000.0L;
+  return((turns - floorl(turns)) * 86400.0L);
+}
+
+// The difference between a GMST in turns and one in seconds, in seconds.
+static double gmst_error(turns_t gmst, long double seconds) {
+  long double d = (long double)gmst * TURNS_TO_SECONDS - seconds;
+  if (d > 43200.0L) {
+    d -= 86400.0L;
+  } else if (d < -43200.0L) {
+    d += 86400.0L;
+  }
+  return((double)d);
+}
+
+// A cycle counter where there is one, and nanoseconds otherwise.
+static uint64_t now_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+// A fast, repeatable stream of pseudo-random numbers.
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return(*state);
+}
+
+int main(int argc, char *argv[]) {
+  long double dut1 = (argc > 1) ? atof(argv[1]) : -0.25;
+  size_t n = (argc > 2) ? (size_t)atol(argv[2]) : 1 << 20;
+  int64_t first = -2732400000LL, last = 4638902400LL;
+  int64_t *t = malloc(n * sizeof(*t));
+  uint16_t *ms = malloc(n * sizeof(*ms));
+  uint64_t state = 0x9e3779b97f4a7c15ULL, checksum = 0, start, elapsed;
+  uint64_t best_fresh = UINT64_MAX, best_stepped = UINT64_MAX;
+  double worst = 0, worst_recent = 0, sum_squares = 0;
+  siderealAnchor anchor = { false, 0, 0 };
+  int r;
+  size_t i;
+
+  if (!t || !ms || (n == 0) || (fabsl(dut1) > 0.9L)) {
+    fprintf(stderr, "usage: %s [dUT1 in seconds, at most 0.9] [times]\n", argv[0]);
+    return(1);
+  }
+  sidereal_set_dut1((int16_t)lrintl(dut1 * 1000.0L));
+
+  for (i = 0; i < n; i++) {
+    t[i] = first + (int64_t)(next_random(&state) % (uint64_t)(last - first));
+    ms[i] = (uint16_t)(next_random(&state) % 1000);
+  }
+  for (i = 0; i < n; i++) {
+    turns_t gmst = sidereal_time2gmst(&anchor, t[i], ms[i], NULL, NULL);
+    double error = gmst_error(gmst, reference_gmst(t[i], ms[i], dut1));
+    sum_squares += error * error;
+    if (fabs(error) > fabs(worst)) {
+      worst = error;
+    }
+    // 1970 to 2070, where most of it will be used.
+    if ((t[i] >= 0) && (t[i] < 3155760000LL) && (fabs(error) > fabs(worst_recent))) {
+      worst_recent = error;
+    }
+  }
+
+  for (r = 0; r < 10; r++) {
+    // A new day every time, so the anchor is evaluated afresh.
+    start = now_cycles();
+    for (i = 0; i < n; i++) {
+      checksum += sidereal_time2gmst(&anchor, t[i], ms[i], NULL, NULL);
+    }
+    elapsed = now_cycles() - start;
+    if (elapsed < best_fresh) {
+      best_fresh = elapsed;
+    }
+
+    // Successive seconds of one day, as the watch sees them.
+    start = now_cycles();
+    for (i = 0; i < n; i++) {
+      checksum += sidereal_time2gmst(&anchor, t[0] + (int64_t)(i % 86400), ms[i], NULL, NULL);
+    }
+    elapsed = now_cycles() - start;
+    if (elapsed < best_stepped) {
+      best_stepped = elapsed;
+    }
+  }
+
+  printf("tier:                      %s\n", TIER_NAME);
+  printf("error vs IAU 2006 + dUT1:  %.3f ms worst, %.3f ms rms, %.3f ms worst 1970-2070 "
+         "(dUT1 %+.3f s)\n", worst * 1e3, sqrt(sum_squares / (double)n) * 1e3,
+         worst_recent * 1e3, (double)dut1);
+#if defined(__x86_64__) || defined(__i386__)
+  printf("cycles per evaluation:     %.1f from scratch, %.1f stepped\n",
+#else
+  printf("ns per evaluation:         %.1f from scratch, %.1f stepped\n",
+#endif
+         (double)best_fresh / (double)n, (double)best_stepped / (double)n);
+  printf("checksum:                  %016llx\n", (unsigned long long)checksum);
+  free(t);
+  free(ms);
+  return(0);
+}
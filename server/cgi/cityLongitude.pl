@@ -2,6 +2,7 @@
 
 use Data::Dumper;
 use CGI qw(:standard);
+use IO::Socket::INET;
 use strict;
 
 # We're here to return the longitude of a city or known observatory, so our
@@ -10,9 +11,6 @@ use strict;
 my $in = CGI->new;
 my %input = $in->Vars;
 
-# The name of the file with the list of cities.
-my $city_file = "worldcitiespop.txt";
-
 # Debugging.
 #$input{'location'} = "perth";
 
@@ -27,48 +25,31 @@ if (!$input{'location'}) {
     exit;
 }
 
-# Check against our list of known observatories.
-my %observatories = (
-    'atca' => { 'names' => [ 'ATCA', "Australia Telescope Compact Array" ],
-		'longitude' => 149.5501388 }
-);
-
-my $s = lc($input{'location'});
-
-if ($observatories{$s}) {
-    # We guess that this is what the user wants.
-    print '"name": [ "'.$observatories{$s}->{'names'}->[0].'" ]'.
-	',"longitude": [ '.$observatories{$s}->{'longitude'}.' ]';
-    
-} else {
-
-    # Otherwise we grep for that string in the text file.
-    my $cmd = "grep \"".$input{'location'}."\" ".$city_file;
-    chomp(my @l = `$cmd`);
-
-    print '"name": [ ';
-    for (my $i = 0; $i <= $#l; $i++) {
-	my @e = split(/\,/, $l[$i]);
-	if ($i > 0) {
-	    print ",";
-	}
-	print '"'.$e[2].' ('.uc($e[3]).', '.uc($e[0]).')"';
-    }
-    print ' ], "longitude": [ ';
-    for (my $i = 0; $i <= $#l; $i++) {
-	my @e = split(/\,/, $l[$i]);
-	if ($i > 0) {
-	    print ',';
-	}
-	my $lo = $e[6];
-	if ($lo =~ /^\-\./) {
-	    $lo =~ s/^\-\.(.*)$/\-0\.$1/;
-	}
-	print $lo;
-    }
-    print ' ]';
+# The search itself is done by citylookupd, from its database of the cities
+# and observatories (see observatories.txt). We just pass the query on.
+my $lookup_host = "127.0.0.1";
+my $lookup_port = 8616;
+
+my $q = $input{'location'};
+$q =~ s/([^A-Za-z0-9\-_.~ ])/sprintf("%%%02X", ord($1))/ge;
+$q =~ tr/ /+/;
+
+my $sock = IO::Socket::INET->new(PeerAddr => $lookup_host,
+				 PeerPort => $lookup_port,
+				 Proto => 'tcp',
+				 Timeout => 5);
+if (!$sock) {
+    print '"error": "The location search is not available." }'."\n";
+    exit;
 }
-
-print "}\n";
+print $sock "GET /?location=".$q." HTTP/1.0\r\n\r\n";
+my $response = do { local $/; <$sock> };
+close($sock);
+
+# Pass the body straight through, without its opening brace, which we have
+# already printed.
+$response =~ s/^.*?\r\n\r\n\{//s;
+binmode(STDOUT, ":raw");
+print $response;
 
 exit;
@@ -0,0 +1,130 @@
+#include "citydb.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// How long does a fresh citylookupd take from starting up to having its
+// first answer? Compare building the index from the text file with mapping
+// the binary database.
+//
+// Usage: citybench [-r runs] [-q query] [-cold] worldcitiespop.txt cities.db
+//
+// Each run is a new process, as a new worker would be. With -cold, both
+// files are dropped from the page cache before every run, so the times
+// include reading them from disk.
+
+#define DEFAULT_RUNS 5
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+static void drop_cache(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+// Open a database one way or the other and search it once, in a child
+// process. Returns the time taken in seconds, and the child's peak RSS.
+static double time_first_result(const char *path, int from_text, const char *query,
+                                long *max_rss_kb) {
+  int fds[2];
+  double seconds = -1;
+  struct rusage usage;
+  int status;
+  pid_t pid;
+  if (pipe(fds) != 0) {
+    return(-1);
+  }
+  pid = fork();
+  if (pid == 0) {
+    cityDb db;
+    cityResult results[1];
+    double t0 = now_seconds();
+    int ok = ((from_text ? citydb_build(&db, path, NULL) : citydb_open(&db, path)) == 0) &&
+      (citydb_search(&db, query, results, 1) == 1);
+    seconds = ok ? now_seconds() - t0 : -1;
+    if (write(fds[1], &seconds, sizeof(seconds)) != sizeof(seconds)) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  if ((pid < 0) || (read(fds[0], &seconds, sizeof(seconds)) != sizeof(seconds))) {
+    seconds = -1;
+  }
+  close(fds[0]);
+  if ((pid > 0) && (wait4(pid, &status, 0, &usage) == pid)) {
+    *max_rss_kb = usage.ru_maxrss;
+  }
+  return(seconds);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return((da > db) - (da < db));
+}
+
+static void report(const char *label, const char *path, int from_text, const char *query,
+                   int runs, int cold) {
+  double *times = malloc((size_t)runs * sizeof(double));
+  long max_rss_kb = 0;
+  int i;
+  for (i = 0; i < runs; i++) {
+    if (cold) {
+      drop_cache(path);
+    }
+    times[i] = time_first_result(path, from_text, query, &max_rss_kb);
+    if (times[i] < 0) {
+      printf("%-6s can't open %s or find \"%s\" in it\n", label, path, query);
+      free(times);
+      return;
+    }
+  }
+  qsort(times, (size_t)runs, sizeof(double), compare_doubles);
+  printf("%-6s median %10.3f ms  min %10.3f ms  max %10.3f ms  peak RSS %7ld kB\n", label,
+         times[runs / 2] * 1e3, times[0] * 1e3, times[runs - 1] * 1e3, max_rss_kb);
+  free(times);
+}
+
+int main(int argc, char *argv[]) {
+  const char *paths[2] = { NULL, NULL };
+  const char *query = "perth";
+  int runs = DEFAULT_RUNS, cold = 0, num_paths = 0, i;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      runs = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-q") == 0) && (i + 1 < argc)) {
+      query = argv[++i];
+    } else if (strcmp(argv[i], "-cold") == 0) {
+      cold = 1;
+    } else if (num_paths < 2) {
+      paths[num_paths++] = argv[i];
+    }
+  }
+  if ((num_paths != 2) || (runs < 1)) {
+    fprintf(stderr, "usage: %s [-r runs] [-q query] [-cold] worldcitiespop.txt cities.db\n",
+            argv[0]);
+    return(1);
+  }
+
+  printf("open to first result for \"%s\", %d %s runs:\n", query, runs, cold ? "cold" : "warm");
+  report("text", paths[0], 1, query, runs, cold);
+  report("binary", paths[1], 0, query, runs, cold);
+  return(0);
+}
@@ -0,0 +1,237 @@
+#include "citydb.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int citydb_open(cityDb *db, const char *path) {
+  int fd = open(path, O_RDONLY);
+  const cityDbHeader *h;
+  struct stat st;
+  uint64_t cities_end, observatories_end, strings_end;
+  memset(db, 0, sizeof(cityDb));
+  if (fd < 0) {
+    return(-1);
+  }
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(cityDbHeader))) {
+    close(fd);
+    return(-1);
+  }
+  db->map_len = (size_t)st.st_size;
+  db->map = mmap(NULL, db->map_len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (db->map == MAP_FAILED) {
+    db->map = NULL;
+    return(-1);
+  }
+
+  // Check that the header is ours and everything it points at is in the
+  // file, but leave the records alone: the pages are only read when a search
+  // touches them.
+  h = db->map;
+  cities_end = (uint64_t)h->cities + (uint64_t)h->num_cities * sizeof(cityRecord);
+  observatories_end = (uint64_t)h->observatories +
+    (uint64_t)h->num_observatories * sizeof(cityRecord);
+  strings_end = (uint64_t)h->strings + h->strings_len;
+  if ((memcmp(h->magic, CITYDB_MAGIC, sizeof(h->magic)) != 0) ||
+      (h->version != CITYDB_VERSION) || (h->byte_order != CITYDB_BYTE_ORDER) ||
+      (h->cities % 4 != 0) || (h->observatories % 4 != 0) ||
+      (cities_end > db->map_len) || (observatories_end > db->map_len) ||
+      (strings_end > db->map_len) || (h->strings_len == 0) ||
+      (((const char *)db->map)[strings_end - 1] != '\0') ||
+      (h->first_byte[256] != h->num_cities)) {
+    citydb_close(db);
+    return(-1);
+  }
+  db->header = h;
+  db->cities = (const cityRecord *)((const char *)db->map + h->cities);
+  db->observatories = (const cityRecord *)((const char *)db->map + h->observatories);
+  db->strings = (const char *)db->map + h->strings;
+  return(0);
+}
+
+void citydb_close(cityDb *db) {
+  if (db->map) {
+    munmap(db->map, db->map_len);
+  }
+  free(db->built_records);
+  free(db->built_strings);
+  memset(db, 0, sizeof(cityDb));
+}
+
+// A string from the pool. The pool ends with a NUL, so anything that starts
+// inside it is safe to read.
+static const char *pool_string(const cityDb *db, uint32_t offset) {
+  return((offset < db->header->strings_len) ? db->strings + offset : "");
+}
+
+// A record's key and its length, trusting neither further than the pool.
+static const char *record_key(const cityDb *db, const cityRecord *r, size_t *len) {
+  if (((uint64_t)r->key + r->key_len) >= db->header->strings_len) {
+    *len = 0;
+    return("");
+  }
+  *len = r->key_len;
+  return(db->strings + r->key);
+}
+
+// Fold the query the same way the names were, dropping surrounding spaces.
+static size_t fold_query(const char *query, char *folded, size_t room) {
+  size_t n = 0;
+  while (isspace((unsigned char)*query)) {
+    query++;
+  }
+  while (*query && (n + 1 < room)) {
+    folded[n++] = (char)tolower((unsigned char)*query++);
+  }
+  while ((n > 0) && isspace((unsigned char)folded[n - 1])) {
+    n--;
+  }
+  folded[n] = '\0';
+  return(n);
+}
+
+// Is a better than b? Exact matches first, then by population.
+static int ranks_above(const cityRecord *a, const cityRecord *b, size_t query_len) {
+  int a_exact = (a->key_len == query_len);
+  int b_exact = (b->key_len == query_len);
+  if (a_exact != b_exact) {
+    return(a_exact);
+  }
+  return(a->population > b->population);
+}
+
+// Find the first record in [lo, hi) whose key isn't less than the query.
+static uint32_t lower_bound(const cityDb *db, const cityRecord *records, uint32_t lo,
+                            uint32_t hi, const char *folded, size_t len) {
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    size_t key_len;
+    const char *key = record_key(db, &records[mid], &key_len);
+    size_t n = (key_len < len) ? key_len : len;
+    int c = memcmp(key, folded, n);
+    if ((c < 0) || ((c == 0) && (key_len < len))) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return(lo);
+}
+
+int citydb_search(const cityDb *db, const char *query, cityResult *results, int max_results) {
+  char folded[256];
+  size_t len = fold_query(query, folded, sizeof(folded));
+  const cityRecord *best[CITYDB_MAX_RESULTS];
+  int num_best = 0;
+  uint32_t i, end;
+  int j;
+
+  if ((len == 0) || (max_results <= 0)) {
+    return(0);
+  }
+  if (max_results > CITYDB_MAX_RESULTS) {
+    max_results = CITYDB_MAX_RESULTS;
+  }
+
+  // Every match starts with the query's first byte, which narrows the
+  // search before it starts.
+  i = db->header->first_byte[(unsigned char)folded[0]];
+  end = db->header->first_byte[(unsigned char)folded[0] + 1];
+  if ((i > end) || (end > db->header->num_cities)) {
+    return(0);
+  }
+  i = lower_bound(db, db->cities, i, end, folded, len);
+
+  // Walk the matches, keeping the best few in rank order.
+  for (; i < end; i++) {
+    const cityRecord *e = &db->cities[i];
+    size_t key_len;
+    const char *key = record_key(db, e, &key_len);
+    if ((key_len < len) || (memcmp(key, folded, len) != 0)) {
+      break;
+    }
+    if ((num_best == max_results) && !ranks_above(e, best[num_best - 1], len)) {
+      continue;
+    }
+    j = (num_best < max_results) ? num_best++ : num_best - 1;
+    while ((j > 0) && ranks_above(e, best[j - 1], len)) {
+      best[j] = best[j - 1];
+      j--;
+    }
+    best[j] = e;
+  }
+
+  for (j = 0; j < num_best; j++) {
+    results[j].name = pool_string(db, best[j]->name);
+    results[j].longitude = pool_string(db, best[j]->longitude);
+  }
+  return(num_best);
+}
+
+int citydb_observatory(const cityDb *db, const char *query, cityResult *result) {
+  char folded[256];
+  size_t len = fold_query(query, folded, sizeof(folded));
+  uint32_t n = db->header->num_observatories;
+  uint32_t i = lower_bound(db, db->observatories, 0, n, folded, len);
+  size_t key_len;
+  if ((len == 0) || (i == n)) {
+    return(0);
+  }
+  if ((memcmp(record_key(db, &db->observatories[i], &key_len), folded, len) != 0) ||
+      (key_len != len)) {
+    return(0);
+  }
+  result->name = pool_string(db, db->observatories[i].name);
+  result->longitude = pool_string(db, db->observatories[i].longitude);
+  return(1);
+}
+
+// Append a JSON string, escaping as needed.
+static size_t put_json_string(char *buf, size_t room, const char *s) {
+  size_t n = 0;
+  if (room < 3) {
+    return(room);
+  }
+  buf[n++] = '"';
+  for (; *s && (n + 7 < room); s++) {
+    unsigned char c = (unsigned char)*s;
+    if ((c == '"') || (c == '\\')) {
+      buf[n++] = '\\';
+      buf[n++] = (char)c;
+    } else if (c < 0x20) {
+      n += snprintf(buf + n, room - n, "\\u%04x", c);
+    } else {
+      buf[n++] = (char)c;
+    }
+  }
+  buf[n++] = '"';
+  return(n);
+}
+
+int citydb_json(const cityResult *results, int num_results, char *buf, size_t buf_len) {
+  size_t n = 0;
+  int i;
+  n += snprintf(buf + n, buf_len - n, "{\"name\": [ ");
+  for (i = 0; (i < num_results) && (n < buf_len); i++) {
+    if (i > 0) {
+      buf[n++] = ',';
+    }
+    n += put_json_string(buf + n, buf_len - n, results[i].name);
+  }
+  if (n < buf_len) {
+    n += snprintf(buf + n, buf_len - n, " ], \"longitude\": [ ");
+  }
+  for (i = 0; (i < num_results) && (n < buf_len); i++) {
+    n += snprintf(buf + n, buf_len - n, "%s%s", (i > 0) ? "," : "", results[i].longitude);
+  }
+  if (n < buf_len) {
+    n += snprintf(buf + n, buf_len - n, " ]}\n");
+  }
+  return((n < buf_len) ? (int)n : -1);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The index of places the configuration page searches: the world cities
+// file plus the observatories we know about.
+//
+// mkcitydb turns worldcitiespop.txt and observatories.txt into a binary
+// database, which citylookupd maps read-only, so starting up costs one mmap
+// and a header check rather than parsing and sorting the text. The file is:
+//
+//   cityDbHeader
+//   cityRecord[num_cities]         sorted by key
+//   cityRecord[num_observatories]  sorted by key
+//   the string pool                NUL-terminated strings, each stored once
+//
+// The records point at their strings by offset into the pool. A record's key
+// is its name folded to lower case, so a prefix search is a binary search to
+// the first key that starts with the (folded) query followed by a walk along
+// the matches. The name and longitude are stored ready to be sent.
+//
+// Everything is in the byte order of the machine that built the file.
+
+#define CITYDB_MAGIC "CITYDB\0\0"
+#define CITYDB_VERSION 1
+#define CITYDB_BYTE_ORDER 0x01020304
+
+// The most results we will ever return for one search.
+#define CITYDB_MAX_RESULTS 200
+
+// The longest name we keep, including its NUL.
+#define CITYDB_NAME_MAX 160
+
+typedef struct _city_db_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t num_cities;
+  uint32_t num_observatories;
+  uint32_t cities;          // Offset of the city records in the file.
+  uint32_t observatories;   // Offset of the observatory records.
+  uint32_t strings;         // Offset of the string pool.
+  uint32_t strings_len;
+  // The index of the first city whose key starts with each byte, or with
+  // anything greater; first_byte[256] is num_cities.
+  uint32_t first_byte[257];
+} cityDbHeader;
+
+typedef struct _city_record {
+  uint32_t key;         // Offsets in the string pool.
+  uint32_t name;
+  uint32_t longitude;
+  uint32_t population;  // Zero if the file doesn't say.
+  uint8_t key_len;
+  uint8_t pad[3];
+} cityRecord;
+
+typedef struct _city_db {
+  const cityDbHeader *header;
+  const cityRecord *cities;
+  const cityRecord *observatories;
+  const char *strings;
+  // What to give back when we're done: a mapping, or the pieces built by
+  // citydb_build.
+  void *map;
+  size_t map_len;
+  void *built_records;
+  void *built_strings;
+} cityDb;
+
+// One search result. The strings point into the database.
+typedef struct _city_result {
+  const char *name;
+  const char *longitude;
+} cityResult;
+
+// Map a database made by mkcitydb. Returns 0 on success.
+int citydb_open(cityDb *db, const char *path);
+void citydb_close(cityDb *db);
+
+// Build a database in memory from the cities and observatories text files
+// (observatories may be NULL). Returns 0 on success. citydb_write saves it
+// for citydb_open.
+int citydb_build(cityDb *db, const char *cities_path, const char *observatories_path);
+int citydb_write(const cityDb *db, const char *path);
+
+// Find up to max_results places whose name starts with query (compared
+// without regard to case). Exact name matches come first, then the rest by
+// population. Returns the number of results written.
+int citydb_search(const cityDb *db, const char *query, cityResult *results, int max_results);
+
+// Look the query up in the known observatories, which take priority over
+// the cities. Returns 1 and fills in result if it matched.
+int citydb_observatory(const cityDb *db, const char *query, cityResult *result);
+
+// Write the results as the JSON object the configuration page expects:
+// {"name": [...], "longitude": [...]}. Returns the length written, or -1 if
+// it didn't fit.
+int citydb_json(const cityResult *results, int num_results, char *buf, size_t buf_len);
@@ -0,0 +1,473 @@
+#include "citydb.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Building a city database from the text files, for mkcitydb. The service
+// itself only ever maps the result.
+
+// The columns of worldcitiespop.txt.
+enum {
+  COLUMN_COUNTRY,
+  COLUMN_CITY,
+  COLUMN_ACCENT_CITY,
+  COLUMN_REGION,
+  COLUMN_POPULATION,
+  COLUMN_LATITUDE,
+  COLUMN_LONGITUDE,
+  NUM_COLUMNS
+};
+
+// The columns of observatories.txt.
+enum {
+  OBSERVATORY_KEY,
+  OBSERVATORY_NAME,
+  OBSERVATORY_LONGITUDE,
+  NUM_OBSERVATORY_COLUMNS
+};
+
+// The string pool as it grows, with a hash table of what's already in it
+// so that every string is stored once.
+typedef struct _string_pool {
+  char *text;
+  size_t len;
+  size_t capacity;
+  uint32_t *slots;  // Offset + 1 of the string in each slot, 0 if empty.
+  size_t num_slots;
+  size_t num_strings;
+} stringPool;
+
+// A growing list of records.
+typedef struct _record_list {
+  cityRecord *records;
+  uint32_t num;
+  uint32_t capacity;
+} recordList;
+
+static uint32_t hash_string(const char *s, size_t len) {
+  uint32_t h = 2166136261u;
+  size_t i;
+  for (i = 0; i < len; i++) {
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  }
+  return(h);
+}
+
+static int pool_grow_slots(stringPool *pool) {
+  size_t num_slots = pool->num_slots ? pool->num_slots * 2 : (1 << 16);
+  uint32_t *slots = calloc(num_slots, sizeof(uint32_t));
+  size_t i;
+  if (!slots) {
+    return(-1);
+  }
+  for (i = 0; i < pool->num_slots; i++) {
+    if (pool->slots[i]) {
+      const char *s = pool->text + pool->slots[i] - 1;
+      size_t j = hash_string(s, strlen(s)) & (num_slots - 1);
+      while (slots[j]) {
+        j = (j + 1) & (num_slots - 1);
+      }
+      slots[j] = pool->slots[i];
+    }
+  }
+  free(pool->slots);
+  pool->slots = slots;
+  pool->num_slots = num_slots;
+  return(0);
+}
+
+// Put a string in the pool, if it isn't there already, and return its
+// offset. Returns UINT32_MAX if we've run out of room.
+static uint32_t pool_add(stringPool *pool, const char *s, size_t len) {
+  size_t i;
+  if ((pool->num_strings + 1) * 2 > pool->num_slots) {
+    if (pool_grow_slots(pool) != 0) {
+      return(UINT32_MAX);
+    }
+  }
+  i = hash_string(s, len) & (pool->num_slots - 1);
+  while (pool->slots[i]) {
+    const char *t = pool->text + pool->slots[i] - 1;
+    if ((memcmp(t, s, len) == 0) && (t[len] == '\0')) {
+      return(pool->slots[i] - 1);
+    }
+    i = (i + 1) & (pool->num_slots - 1);
+  }
+  if (pool->len + len + 1 >= UINT32_MAX) {
+    return(UINT32_MAX);
+  }
+  if (pool->len + len + 1 > pool->capacity) {
+    size_t capacity = pool->capacity ? pool->capacity : (1 << 20);
+    char *text;
+    while (pool->len + len + 1 > capacity) {
+      capacity *= 2;
+    }
+    text = realloc(pool->text, capacity);
+    if (!text) {
+      return(UINT32_MAX);
+    }
+    pool->text = text;
+    pool->capacity = capacity;
+  }
+  memcpy(pool->text + pool->len, s, len);
+  pool->text[pool->len + len] = '\0';
+  pool->slots[i] = (uint32_t)pool->len + 1;
+  pool->num_strings++;
+  pool->len += len + 1;
+  return(pool->slots[i] - 1);
+}
+
+static cityRecord *list_add(recordList *list) {
+  if (list->num == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2 : (1 << 16);
+    cityRecord *records = realloc(list->records, capacity * sizeof(cityRecord));
+    if (!records) {
+      return(NULL);
+    }
+    list->records = records;
+    list->capacity = capacity;
+  }
+  memset(&list->records[list->num], 0, sizeof(cityRecord));
+  return(&list->records[list->num++]);
+}
+
+// Read a whole file, with a NUL after it.
+static char *read_file(const char *path, size_t *len) {
+  FILE *fp = fopen(path, "rb");
+  char *text;
+  if (!fp) {
+    return(NULL);
+  }
+  fseek(fp, 0, SEEK_END);
+  *len = (size_t)ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  text = malloc(*len + 1);
+  if (text && (fread(text, 1, *len, fp) != *len)) {
+    free(text);
+    text = NULL;
+  }
+  fclose(fp);
+  if (text) {
+    text[*len] = '\0';
+  }
+  return(text);
+}
+
+// Split a row into comma-separated columns. Returns the number found.
+static int split_row(const char *line, const char *end, int max_columns,
+                     const char **columns, size_t *lengths) {
+  int n = 0;
+  const char *start = line;
+  const char *p;
+  for (p = line; (p <= end) && (n < max_columns); p++) {
+    if ((p == end) || (*p == ',')) {
+      columns[n] = start;
+      lengths[n] = (size_t)(p - start);
+      n++;
+      start = p + 1;
+    }
+  }
+  return(n);
+}
+
+// Only rows with a plain decimal longitude are worth keeping, and it keeps
+// the JSON we write well formed.
+static int is_number(const char *s, size_t len) {
+  size_t i;
+  if (len == 0) {
+    return(0);
+  }
+  for (i = 0; i < len; i++) {
+    if (!isdigit((unsigned char)s[i]) && (s[i] != '.') &&
+        !((i == 0) && ((s[i] == '-') || (s[i] == '+')))) {
+      return(0);
+    }
+  }
+  return(1);
+}
+
+// Copy a Latin-1 string as UTF-8, upper-casing it if asked. As much as
+// fits in room is copied, a whole character at a time, and the length
+// copied is returned, which always leaves room for the NUL.
+static size_t copy_utf8(char *dst, size_t room, const char *src, size_t len, int upper) {
+  size_t n = 0;
+  size_t i;
+  for (i = 0; (i < len) && (n + 2 < room); i++) {
+    unsigned char c = (unsigned char)src[i];
+    if (c < 0x80) {
+      dst[n++] = upper ? (char)toupper(c) : (char)c;
+    } else {
+      dst[n++] = (char)(0xC0 | (c >> 6));
+      dst[n++] = (char)(0x80 | (c & 0x3F));
+    }
+  }
+  dst[n] = '\0';
+  return(n);
+}
+
+// Append text to the n bytes already in dst, as much of it as fits, and
+// return the new length, which like copy_utf8's leaves room for the NUL.
+static size_t append_text(char *dst, size_t room, size_t n, const char *text) {
+  size_t len = strlen(text);
+  if (len > room - 1 - n) {
+    len = room - 1 - n;
+  }
+  memcpy(dst + n, text, len);
+  dst[n + len] = '\0';
+  return(n + len);
+}
+
+// The longitude, with a leading zero if the file left it off.
+static size_t fix_longitude(char *dst, size_t room, const char *lng, size_t n) {
+  int len;
+  if ((n > 1) && (lng[0] == '-') && (lng[1] == '.')) {
+    len = snprintf(dst, room, "-0%.*s", (int)(n - 1), lng + 1);
+  } else if ((n > 0) && (lng[0] == '.')) {
+    len = snprintf(dst, room, "0%.*s", (int)n, lng);
+  } else {
+    len = snprintf(dst, room, "%.*s", (int)n, lng);
+  }
+  return(((size_t)len < room) ? (size_t)len : room - 1);
+}
+
+// Fold a key to lower case, the way searches are folded.
+static size_t fold_key(char *dst, size_t room, const char *src, size_t len) {
+  size_t i;
+  for (i = 0; (i < len) && (i + 1 < room); i++) {
+    dst[i] = (char)tolower((unsigned char)src[i]);
+  }
+  dst[i] = '\0';
+  return(i);
+}
+
+// Read each row of the cities file into a record:
+// "AccentCity (REGION, COUNTRY)" and the longitude.
+static int add_cities(char *text, size_t text_len, stringPool *pool, recordList *list) {
+  char *p = text;
+  char *end = text + text_len;
+  while (p < end) {
+    char *eol = memchr(p, '\n', (size_t)(end - p));
+    char *line_end;
+    const char *columns[NUM_COLUMNS];
+    size_t lengths[NUM_COLUMNS];
+    if (!eol) {
+      eol = end;
+    }
+    line_end = eol;
+    if ((line_end > p) && (line_end[-1] == '\r')) {
+      line_end--;
+    }
+    // The first row is the header.
+    if ((p != text) &&
+        (split_row(p, line_end, NUM_COLUMNS, columns, lengths) == NUM_COLUMNS) &&
+        (lengths[COLUMN_CITY] > 0) && (lengths[COLUMN_CITY] < 256) &&
+        is_number(columns[COLUMN_LONGITUDE], lengths[COLUMN_LONGITUDE])) {
+      char key[256];
+      char buf[CITYDB_NAME_MAX];
+      size_t n;
+      cityRecord *r = list_add(list);
+      if (!r) {
+        return(-1);
+      }
+      n = fold_key(key, sizeof(key), columns[COLUMN_CITY], lengths[COLUMN_CITY]);
+      r->key = pool_add(pool, key, n);
+      r->key_len = (uint8_t)n;
+
+      n = copy_utf8(buf, sizeof(buf), columns[COLUMN_ACCENT_CITY],
+                    lengths[COLUMN_ACCENT_CITY], 0);
+      // A long name is cut short, rather than running off the end.
+      n = append_text(buf, sizeof(buf), n, " (");
+      n += copy_utf8(buf + n, sizeof(buf) - n, columns[COLUMN_REGION],
+                     lengths[COLUMN_REGION], 1);
+      n = append_text(buf, sizeof(buf), n, ", ");
+      n += copy_utf8(buf + n, sizeof(buf) - n, columns[COLUMN_COUNTRY],
+                     lengths[COLUMN_COUNTRY], 1);
+      n = append_text(buf, sizeof(buf), n, ")");
+      r->name = pool_add(pool, buf, n);
+
+      n = fix_longitude(buf, sizeof(buf), columns[COLUMN_LONGITUDE], lengths[COLUMN_LONGITUDE]);
+      r->longitude = pool_add(pool, buf, n);
+      r->population = (uint32_t)strtoul(columns[COLUMN_POPULATION], NULL, 10);
+      if ((r->key == UINT32_MAX) || (r->name == UINT32_MAX) || (r->longitude == UINT32_MAX)) {
+        return(-1);
+      }
+    }
+    p = eol + 1;
+  }
+  return(0);
+}
+
+// Read the observatories file: key,name,longitude on each line, with blank
+// lines and lines starting with # ignored.
+static int add_observatories(char *text, size_t text_len, stringPool *pool, recordList *list) {
+  char *p = text;
+  char *end = text + text_len;
+  while (p < end) {
+    char *eol = memchr(p, '\n', (size_t)(end - p));
+    char *line_end;
+    const char *columns[NUM_OBSERVATORY_COLUMNS];
+    size_t lengths[NUM_OBSERVATORY_COLUMNS];
+    if (!eol) {
+      eol = end;
+    }
+    line_end = eol;
+    if ((line_end > p) && (line_end[-1] == '\r')) {
+      line_end--;
+    }
+    if ((line_end > p) && (*p != '#') &&
+        (split_row(p, line_end, NUM_OBSERVATORY_COLUMNS, columns, lengths) ==
+         NUM_OBSERVATORY_COLUMNS) &&
+        (lengths[OBSERVATORY_KEY] > 0) && (lengths[OBSERVATORY_KEY] < 256) &&
+        (lengths[OBSERVATORY_NAME] < CITYDB_NAME_MAX) &&
+        is_number(columns[OBSERVATORY_LONGITUDE], lengths[OBSERVATORY_LONGITUDE])) {
+      char buf[256];
+      size_t n;
+      cityRecord *r = list_add(list);
+      if (!r) {
+        return(-1);
+      }
+      n = fold_key(buf, sizeof(buf), columns[OBSERVATORY_KEY], lengths[OBSERVATORY_KEY]);
+      r->key = pool_add(pool, buf, n);
+      r->key_len = (uint8_t)n;
+      r->name = pool_add(pool, columns[OBSERVATORY_NAME], lengths[OBSERVATORY_NAME]);
+      n = fix_longitude(buf, sizeof(buf), columns[OBSERVATORY_LONGITUDE],
+                        lengths[OBSERVATORY_LONGITUDE]);
+      r->longitude = pool_add(pool, buf, n);
+      if ((r->key == UINT32_MAX) || (r->name == UINT32_MAX) || (r->longitude == UINT32_MAX)) {
+        return(-1);
+      }
+    } else if ((line_end > p) && (*p != '#')) {
+      fprintf(stderr, "observatories: skipping \"%.*s\"\n", (int)(line_end - p), p);
+    }
+    p = eol + 1;
+  }
+  return(0);
+}
+
+// The pool the records are sorted against, for qsort.
+static const char *s_sort_strings;
+
+// By key, then the most populous first, so the file comes out the same
+// every time.
+static int compare_records(const void *a, const void *b) {
+  const cityRecord *ra = a;
+  const cityRecord *rb = b;
+  size_t n = (ra->key_len < rb->key_len) ? ra->key_len : rb->key_len;
+  int c = memcmp(s_sort_strings + ra->key, s_sort_strings + rb->key, n);
+  if (c != 0) {
+    return(c);
+  }
+  if (ra->key_len != rb->key_len) {
+    return((int)ra->key_len - (int)rb->key_len);
+  }
+  if (ra->population != rb->population) {
+    return((ra->population > rb->population) ? -1 : 1);
+  }
+  return(strcmp(s_sort_strings + ra->name, s_sort_strings + rb->name));
+}
+
+int citydb_build(cityDb *db, const char *cities_path, const char *observatories_path) {
+  stringPool pool;
+  recordList cities, observatories;
+  cityDbHeader *h;
+  char *text;
+  size_t text_len, block_len;
+  uint64_t file_len;
+  int result = -1;
+  uint32_t i;
+  int b;
+
+  memset(db, 0, sizeof(cityDb));
+  memset(&pool, 0, sizeof(pool));
+  memset(&cities, 0, sizeof(cities));
+  memset(&observatories, 0, sizeof(observatories));
+
+  // Offset 0 is the empty string.
+  if (pool_add(&pool, "", 0) == UINT32_MAX) {
+    goto done;
+  }
+  if (observatories_path) {
+    if (!(text = read_file(observatories_path, &text_len))) {
+      goto done;
+    }
+    result = add_observatories(text, text_len, &pool, &observatories);
+    free(text);
+    if (result != 0) {
+      goto done;
+    }
+    result = -1;
+  }
+  if (!(text = read_file(cities_path, &text_len))) {
+    goto done;
+  }
+  result = add_cities(text, text_len, &pool, &cities);
+  free(text);
+  if (result != 0) {
+    goto done;
+  }
+  result = -1;
+
+  s_sort_strings = pool.text;
+  qsort(cities.records, cities.num, sizeof(cityRecord), compare_records);
+  qsort(observatories.records, observatories.num, sizeof(cityRecord), compare_records);
+
+  // The header and records go together, just as they'll be in the file.
+  block_len = sizeof(cityDbHeader) + ((size_t)cities.num + observatories.num) * sizeof(cityRecord);
+  file_len = (uint64_t)block_len + pool.len;
+  if ((file_len > UINT32_MAX) || !(h = calloc(1, block_len))) {
+    goto done;
+  }
+  memcpy(h->magic, CITYDB_MAGIC, sizeof(h->magic));
+  h->version = CITYDB_VERSION;
+  h->byte_order = CITYDB_BYTE_ORDER;
+  h->num_cities = cities.num;
+  h->num_observatories = observatories.num;
+  h->cities = sizeof(cityDbHeader);
+  h->observatories = h->cities + cities.num * (uint32_t)sizeof(cityRecord);
+  h->strings = (uint32_t)block_len;
+  h->strings_len = (uint32_t)pool.len;
+  if (cities.num > 0) {
+    memcpy((char *)h + h->cities, cities.records, cities.num * sizeof(cityRecord));
+  }
+  if (observatories.num > 0) {
+    memcpy((char *)h + h->observatories, observatories.records,
+           observatories.num * sizeof(cityRecord));
+  }
+  for (b = 0, i = 0; b <= 256; b++) {
+    while ((i < cities.num) && ((unsigned char)pool.text[cities.records[i].key] < b)) {
+      i++;
+    }
+    h->first_byte[b] = i;
+  }
+  h->first_byte[256] = cities.num;
+
+  db->header = h;
+  db->cities = (const cityRecord *)((const char *)h + h->cities);
+  db->observatories = (const cityRecord *)((const char *)h + h->observatories);
+  db->strings = pool.text;
+  db->built_records = h;
+  db->built_strings = pool.text;
+  pool.text = NULL;
+  result = 0;
+
+done:
+  free(pool.text);
+  free(pool.slots);
+  free(cities.records);
+  free(observatories.records);
+  return(result);
+}
+
+int citydb_write(const cityDb *db, const char *path) {
+  const cityDbHeader *h = db->header;
+  FILE *fp = fopen(path, "wb");
+  int ok;
+  if (!fp) {
+    return(-1);
+  }
+  ok = (fwrite(h, 1, h->strings, fp) == h->strings) &&
+    (fwrite(db->strings, 1, h->strings_len, fp) == h->strings_len);
+  return((fclose(fp) == 0) && ok ? 0 : -1);
+}
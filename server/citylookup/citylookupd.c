@@ -0,0 +1,202 @@
+#include "citydb.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+// A small HTTP service answering location searches for the configuration
+// page, from the city database made by mkcitydb.
+//
+// Usage: citylookupd [-p port] [-a address] [-n max_results] [-w workers] cities.db
+//
+// The database is mapped read-only, so workers share its pages.
+//
+// GET /?location=perth returns {"name": [...], "longitude": [...]}, just as
+// cityLongitude.pl always has.
+
+#define DEFAULT_PORT 8616
+#define DEFAULT_RESULTS 50
+#define REQUEST_MAX 4096
+#define RESPONSE_MAX (CITYDB_MAX_RESULTS * 200 + 256)
+
+static int hex_value(char c) {
+  if ((c >= '0') && (c <= '9')) {
+    return(c - '0');
+  }
+  c = (char)tolower((unsigned char)c);
+  if ((c >= 'a') && (c <= 'f')) {
+    return(c - 'a' + 10);
+  }
+  return(-1);
+}
+
+// Find a parameter in a query string and URL-decode it into value.
+static int query_param(const char *query, const char *name, char *value, size_t room) {
+  size_t name_len = strlen(name);
+  const char *p = query;
+  while (p && *p) {
+    if ((strncmp(p, name, name_len) == 0) && (p[name_len] == '=')) {
+      size_t n = 0;
+      p += name_len + 1;
+      while (*p && (*p != '&') && (*p != ' ') && (n + 1 < room)) {
+        if ((*p == '%') && (hex_value(p[1]) >= 0) && (hex_value(p[2]) >= 0)) {
+          value[n++] = (char)(hex_value(p[1]) * 16 + hex_value(p[2]));
+          p += 3;
+        } else if (*p == '+') {
+          value[n++] = ' ';
+          p++;
+        } else {
+          value[n++] = *p++;
+        }
+      }
+      value[n] = '\0';
+      return(1);
+    }
+    p = strchr(p, '&');
+    if (p) {
+      p++;
+    }
+  }
+  return(0);
+}
+
+static void send_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n <= 0) {
+      return;
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+static void handle_request(const cityDb *db, int fd, int default_results) {
+  static char request[REQUEST_MAX];
+  static char body[RESPONSE_MAX];
+  static cityResult results[CITYDB_MAX_RESULTS];
+  char header[256];
+  char location[256];
+  char max_param[16];
+  const char *query;
+  ssize_t n = read(fd, request, sizeof(request) - 1);
+  int num_results = 0;
+  int max_results = default_results;
+  const char *status = "200 OK";
+  int body_len;
+
+  if (n <= 0) {
+    return;
+  }
+  request[n] = '\0';
+  query = strchr(request, '?');
+  if ((strncmp(request, "GET ", 4) != 0) || !query ||
+      !query_param(query + 1, "location", location, sizeof(location)) ||
+      (location[0] == '\0')) {
+    body_len = snprintf(body, sizeof(body), "{\"error\": \"No location to search for.\" }\n");
+  } else {
+    if (query_param(query + 1, "max", max_param, sizeof(max_param))) {
+      max_results = atoi(max_param);
+    }
+    if (citydb_observatory(db, location, &results[0])) {
+      num_results = 1;
+    } else {
+      num_results = citydb_search(db, location, results, max_results);
+    }
+    body_len = citydb_json(results, num_results, body, sizeof(body));
+  }
+  // The results didn't fit, so there's nothing whole to send.
+  if ((body_len < 0) || ((size_t)body_len >= sizeof(body))) {
+    status = "500 Internal Server Error";
+    body_len = snprintf(body, sizeof(body), "{\"error\": \"Too many results to send.\" }\n");
+  }
+
+  snprintf(header, sizeof(header),
+           "HTTP/1.0 %s\r\n"
+           "Content-Type: text/json; charset=UTF-8\r\n"
+           "Access-Control-Allow-Origin: *\r\n"
+           "Content-Length: %d\r\n"
+           "Connection: close\r\n\r\n", status, body_len);
+  send_all(fd, header, strlen(header));
+  send_all(fd, body, (size_t)body_len);
+}
+
+int main(int argc, char *argv[]) {
+  const char *address = "127.0.0.1";
+  int port = DEFAULT_PORT;
+  int default_results = DEFAULT_RESULTS;
+  int workers = 1;
+  const char *path = NULL;
+  struct sockaddr_in addr;
+  struct timespec t0, t1;
+  cityDb db;
+  int listener, one = 1, i;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      port = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-a") == 0) && (i + 1 < argc)) {
+      address = argv[++i];
+    } else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+      default_results = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+      workers = atoi(argv[++i]);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [-p port] [-a address] [-n max_results] [-w workers] cities.db\n",
+            argv[0]);
+    return(1);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (citydb_open(&db, path) != 0) {
+    fprintf(stderr, "%s: can't open %s\n", argv[0], path);
+    return(1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  fprintf(stderr, "%s: mapped %u places and %u observatories in %.3f ms\n", argv[0],
+          db.header->num_cities, db.header->num_observatories,
+          (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6);
+
+  signal(SIGPIPE, SIG_IGN);
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  inet_pton(AF_INET, address, &addr.sin_addr);
+  if ((bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+      (listen(listener, 128) != 0)) {
+    perror("citylookupd");
+    return(1);
+  }
+
+  // Searches take microseconds, so one at a time is plenty for a worker;
+  // any more are forked here and take turns accepting.
+  for (i = 1; i < workers; i++) {
+    if (fork() == 0) {
+      break;
+    }
+  }
+  for (;;) {
+    struct timeval timeout = { 5, 0 };
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    handle_request(&db, fd, default_results);
+    close(fd);
+  }
+}
@@ -0,0 +1,136 @@
+// How does searching the configuration page's own city index compare with
+// asking the server? Reports the size of the index as fetched, how long the
+// page takes to parse it, and the latency of local searches; then, if
+// citylookupd is running, the latency of the same searches made of it, and
+// whether the two agree on every place the index holds.
+//
+// Usage: node indexbench.js [-n searches] [-p port] cities.idx
+
+var fs = require('fs');
+var http = require('http');
+var zlib = require('zlib');
+var cityIndex = require('../www/cityIndex.js');
+
+var args = process.argv.slice(2);
+var numSearches = 2000;
+var port = 8616;
+var path = null;
+for (var a = 0; a < args.length; a++) {
+    if ((args[a] === '-n') && (a + 1 < args.length)) {
+	numSearches = parseInt(args[++a], 10);
+    } else if ((args[a] === '-p') && (a + 1 < args.length)) {
+	port = parseInt(args[++a], 10);
+    } else {
+	path = args[a];
+    }
+}
+if (!path) {
+    console.error('usage: node indexbench.js [-n searches] [-p port] cities.idx');
+    process.exit(1);
+}
+
+var percentile = function(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+};
+
+var report = function(label, times) {
+    times.sort(function(a, b) { return a - b; });
+    console.log(label + ' p50 ' + percentile(times, 0.5).toFixed(3) + ' ms, p99 ' +
+		percentile(times, 0.99).toFixed(3) + ' ms');
+};
+
+var text = fs.readFileSync(path, 'utf8');
+var raw = Buffer.byteLength(text);
+console.log('index: ' + raw + ' bytes, ' + zlib.gzipSync(text, { 'level': 9 }).length +
+	    ' gzipped');
+
+var t0 = process.hrtime.bigint();
+var index = cityIndex.parse(text);
+console.log('parse: ' + (Number(process.hrtime.bigint() - t0) / 1e6).toFixed(1) + ' ms for ' +
+	    index.keys.length + ' places');
+
+// Queries as people type them: the first few letters of a real place name,
+// spread through the index, so some are short and match thousands.
+var queries = [];
+for (var i = 0; i < numSearches; i++) {
+    var key = index.keys[Math.floor((i + 0.5) * index.keys.length / numSearches)];
+    queries.push(key.substring(0, 2 + (i % 5)));
+}
+
+var localTimes = [];
+var results = [];
+for (i = 0; i < queries.length; i++) {
+    t0 = process.hrtime.bigint();
+    results.push(cityIndex.search(index, queries[i]));
+    localTimes.push(Number(process.hrtime.bigint() - t0) / 1e6);
+}
+report('local search:  ', localTimes);
+
+// Every place in the index, by name and longitude (names aren't unique), to
+// pick them out of the server's answers.
+var place = function(name, longitude) {
+    return name + '@' + parseFloat(longitude);
+};
+var held = {};
+for (i = 0; i < index.keys.length; i++) {
+    held[place(cityIndex.displayName(index, i), index.longitudes[i])] = true;
+}
+
+var ask = function(q, callback) {
+    var start = process.hrtime.bigint();
+    http.get({ 'host': '127.0.0.1', 'port': port,
+	       'path': '/?location=' + encodeURIComponent(q) }, function(res) {
+	var body = '';
+	res.setEncoding('utf8');
+	res.on('data', function(chunk) { body += chunk; });
+	res.on('end', function() {
+	    callback(JSON.parse(body), Number(process.hrtime.bigint() - start) / 1e6,
+		     Buffer.byteLength(body));
+	});
+    }).on('error', function() { callback(null, 0, 0); });
+};
+
+var serverTimes = [];
+var serverBytes = 0;
+var disagreements = 0;
+var next = function(n) {
+    if (n === queries.length) {
+	report('server search: ', serverTimes);
+	console.log('server answers: ' + (serverBytes / queries.length).toFixed(0) +
+		    ' bytes each; ' + disagreements + ' of ' + queries.length +
+		    ' disagree with the index');
+	return;
+    }
+    ask(queries[n], function(d, ms, bytes) {
+	if (!d) {
+	    console.log('server search:  citylookupd is not running on port ' + port);
+	    return;
+	}
+	serverTimes.push(ms);
+	serverBytes += bytes;
+	// The index leaves out places without a population, which the server
+	// ranks after the rest of the exact matches, and then after everything;
+	// so the server's answer, less those, should start the index's, and be
+	// all of it unless the server stopped at its limit.
+	var mine = [], theirs = [];
+	for (var k = 0; results[n] && (k < results[n].name.length); k++) {
+	    mine.push(place(results[n].name[k], results[n].longitude[k]));
+	}
+	for (k = 0; k < d.name.length; k++) {
+	    if (held[place(d.name[k], d.longitude[k])]) {
+		theirs.push(place(d.name[k], d.longitude[k]));
+	    }
+	}
+	if ((mine.slice(0, theirs.length).join('|') !== theirs.join('|')) ||
+	    ((d.name.length < 50) && (mine.length !== theirs.length))) {
+	    disagreements++;
+	    if (disagreements <= 3) {
+		console.log('disagree on "' + queries[n] + '": ' + mine.join('|') + ' vs ' +
+			    theirs.join('|'));
+	    }
+	}
+	next(n + 1);
+    });
+};
+
+next(0);
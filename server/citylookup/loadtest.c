@@ -0,0 +1,172 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Load test for citylookupd: fire searches for real place-name prefixes at
+// it from several clients at once, and report latency and throughput.
+//
+// Usage: loadtest [-p port] [-c clients] [-n requests] worldcitiespop.txt
+
+#define MAX_QUERIES 4096
+
+static int s_port = 8616;
+static int s_requests = 20000;
+static char s_queries[MAX_QUERIES][32];
+static int s_num_queries = 0;
+static double *s_latencies;
+static int s_next = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+// Take the city names of rows spread through the file, and cut each one to
+// a prefix of a few characters, the way people type searches.
+static int load_queries(const char *path) {
+  FILE *fp = fopen(path, "r");
+  char line[512];
+  long size, step;
+  if (!fp) {
+    return(-1);
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  step = size / MAX_QUERIES;
+  while (s_num_queries < MAX_QUERIES) {
+    char *city, *end;
+    size_t len;
+    fseek(fp, (long)s_num_queries * step, SEEK_SET);
+    if (!fgets(line, sizeof(line), fp) || !fgets(line, sizeof(line), fp)) {
+      break;
+    }
+    city = strchr(line, ',');
+    if (!city || !(end = strchr(++city, ','))) {
+      continue;
+    }
+    len = (size_t)(end - city);
+    if (len > 3 + (size_t)(s_num_queries % 6)) {
+      len = 3 + (size_t)(s_num_queries % 6);
+    }
+    if (len >= sizeof(s_queries[0])) {
+      len = sizeof(s_queries[0]) - 1;
+    }
+    memcpy(s_queries[s_num_queries], city, len);
+    s_queries[s_num_queries][len] = '\0';
+    s_num_queries++;
+  }
+  fclose(fp);
+  return(s_num_queries > 0 ? 0 : -1);
+}
+
+// One search, start to finish, as a browser would make it.
+static int do_request(const char *query) {
+  struct sockaddr_in addr;
+  char request[256], response[65536];
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ssize_t n, total = 0;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)s_port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return(-1);
+  }
+  n = snprintf(request, sizeof(request), "GET /?location=%s HTTP/1.0\r\n\r\n", query);
+  if (write(fd, request, (size_t)n) != n) {
+    close(fd);
+    return(-1);
+  }
+  while ((n = read(fd, response, sizeof(response))) > 0) {
+    total += n;
+  }
+  close(fd);
+  return(total > 0 ? 0 : -1);
+}
+
+static void *client(void *arg) {
+  (void)arg;
+  for (;;) {
+    int i;
+    double t0;
+    pthread_mutex_lock(&s_lock);
+    i = s_next++;
+    pthread_mutex_unlock(&s_lock);
+    if (i >= s_requests) {
+      return(NULL);
+    }
+    t0 = now_seconds();
+    if (do_request(s_queries[i % s_num_queries]) != 0) {
+      s_latencies[i] = -1;
+    } else {
+      s_latencies[i] = now_seconds() - t0;
+    }
+  }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return((da > db) - (da < db));
+}
+
+int main(int argc, char *argv[]) {
+  int clients = 4, i, failures = 0;
+  const char *path = NULL;
+  pthread_t *threads;
+  double t0, elapsed;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      s_port = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+      clients = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+      s_requests = atoi(argv[++i]);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path || (load_queries(path) != 0)) {
+    fprintf(stderr, "usage: %s [-p port] [-c clients] [-n requests] worldcitiespop.txt\n",
+            argv[0]);
+    return(1);
+  }
+
+  s_latencies = calloc((size_t)s_requests, sizeof(double));
+  threads = calloc((size_t)clients, sizeof(pthread_t));
+  t0 = now_seconds();
+  for (i = 0; i < clients; i++) {
+    pthread_create(&threads[i], NULL, client, NULL);
+  }
+  for (i = 0; i < clients; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  elapsed = now_seconds() - t0;
+
+  qsort(s_latencies, (size_t)s_requests, sizeof(double), compare_doubles);
+  while ((failures < s_requests) && (s_latencies[failures] < 0)) {
+    failures++;
+  }
+  if (failures == s_requests) {
+    fprintf(stderr, "%s: every request failed\n", argv[0]);
+    return(1);
+  }
+  printf("requests:  %d from %d clients (%d failed)\n", s_requests, clients, failures);
+  printf("p50:       %.3f ms\n", 1e3 * s_latencies[failures + (s_requests - failures) / 2]);
+  printf("p99:       %.3f ms\n",
+         1e3 * s_latencies[failures + (int)((s_requests - failures - 1) * 0.99)]);
+  printf("max:       %.3f ms\n", 1e3 * s_latencies[s_requests - 1]);
+  printf("rate:      %.0f queries/s\n", (double)s_requests / elapsed);
+  return(0);
+}
@@ -0,0 +1,48 @@
+#include "citydb.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Turn the cities and observatories text files into the binary database
+// that citylookupd maps.
+//
+// Usage: mkcitydb [-o observatories.txt] worldcitiespop.txt cities.db
+
+int main(int argc, char *argv[]) {
+  const char *observatories = NULL;
+  const char *paths[2] = { NULL, NULL };
+  int num_paths = 0, i;
+  struct timespec t0, t1;
+  cityDb db;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+      observatories = argv[++i];
+    } else if (num_paths < 2) {
+      paths[num_paths++] = argv[i];
+    }
+  }
+  if (num_paths != 2) {
+    fprintf(stderr, "usage: %s [-o observatories.txt] worldcitiespop.txt cities.db\n", argv[0]);
+    return(1);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (citydb_build(&db, paths[0], observatories) != 0) {
+    fprintf(stderr, "%s: can't build from %s%s%s\n", argv[0], paths[0],
+            observatories ? " and " : "", observatories ? observatories : "");
+    return(1);
+  }
+  if (citydb_write(&db, paths[1]) != 0) {
+    fprintf(stderr, "%s: can't write %s\n", argv[0], paths[1]);
+    return(1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  fprintf(stderr, "%s: %u places and %u observatories, %u bytes of strings, in %.2f s\n",
+          argv[0], db.header->num_cities, db.header->num_observatories,
+          db.header->strings_len,
+          (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9);
+  citydb_close(&db);
+  return(0);
+}
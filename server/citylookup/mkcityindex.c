@@ -0,0 +1,169 @@
+#include "citydb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Write the compact city index that the configuration page searches by
+// itself, from the database made by mkcitydb. It holds every observatory and
+// each place with a known population of at least min_population (1 by
+// default, so every place whose population is known), which covers almost
+// every search anyone makes; the page asks citylookupd about the rest.
+//
+// Usage: mkcityindex [-p min_population] cities.db cities.idx
+//
+// The index is UTF-8 text, one place to a line, so it compresses well when
+// served and is quick for the page to split up:
+//
+//   CITYIDX 1 <observatories> <cities>
+//   <key> TAB <name> TAB <longitude>                        each observatory
+//   <shared><suffix> TAB <name> TAB <longitude> TAB <population>  each city
+//
+// The cities are sorted by key, as they are in the database. Each key is
+// front coded: <shared> is one character, '0' plus how many leading bytes it
+// shares with the key before, and <suffix> is the rest of it. A name that
+// starts with its key in title case ("Perth (08, AU)" for "perth") has that
+// part replaced by a *. Populations are in base 36. Only places whose keys
+// are plain ASCII are included, so the page and the database agree on how
+// keys sort.
+
+#define INDEX_VERSION 1
+
+// The most leading bytes a key can share, so <shared> stays printable.
+#define MAX_SHARED 40
+
+// Is a string safe to put in a tab-separated line?
+static int is_plain(const char *s, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    if ((s[i] == '\t') || (s[i] == '\n') || (s[i] == '\r')) {
+      return(0);
+    }
+  }
+  return(1);
+}
+
+static int is_ascii(const char *s, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    if ((unsigned char)s[i] >= 0x80) {
+      return(0);
+    }
+  }
+  return(1);
+}
+
+// How much of a name is its key in title case: a capital at the start and
+// after each space or hyphen. The page puts it back the same way.
+static size_t title_case_length(const char *key, size_t key_len, const char *name) {
+  size_t i;
+  for (i = 0; i < key_len; i++) {
+    char c = key[i];
+    if (((i == 0) || (key[i - 1] == ' ') || (key[i - 1] == '-')) && (c >= 'a') && (c <= 'z')) {
+      c = (char)(c - 'a' + 'A');
+    }
+    if (name[i] != c) {
+      return(0);
+    }
+  }
+  return(key_len);
+}
+
+static void put_base36(FILE *fp, uint32_t n) {
+  char digits[8];
+  int i = 0;
+  do {
+    int d = (int)(n % 36);
+    digits[i++] = (char)((d < 10) ? '0' + d : 'a' + d - 10);
+    n /= 36;
+  } while (n > 0);
+  while (i > 0) {
+    fputc(digits[--i], fp);
+  }
+}
+
+static const char *pool_string(const cityDb *db, uint32_t offset) {
+  return((offset < db->header->strings_len) ? db->strings + offset : "");
+}
+
+static int wanted(const cityDb *db, const cityRecord *r, uint32_t min_population) {
+  const char *name = pool_string(db, r->name);
+  return((r->population >= min_population) && (r->key_len > 0) &&
+         ((uint64_t)r->key + r->key_len < db->header->strings_len) &&
+         is_plain(db->strings + r->key, r->key_len) &&
+         is_ascii(db->strings + r->key, r->key_len) && is_plain(name, strlen(name)));
+}
+
+int main(int argc, char *argv[]) {
+  const char *paths[2] = { NULL, NULL };
+  uint32_t min_population = 1, num_cities = 0, i;
+  const char *previous = "";
+  size_t previous_len = 0;
+  int num_paths = 0, j;
+  long size;
+  cityDb db;
+  FILE *fp;
+
+  for (j = 1; j < argc; j++) {
+    if ((strcmp(argv[j], "-p") == 0) && (j + 1 < argc)) {
+      min_population = (uint32_t)strtoul(argv[++j], NULL, 10);
+    } else if (num_paths < 2) {
+      paths[num_paths++] = argv[j];
+    }
+  }
+  if ((num_paths != 2) || (min_population == 0)) {
+    fprintf(stderr, "usage: %s [-p min_population] cities.db cities.idx\n", argv[0]);
+    return(1);
+  }
+  if (citydb_open(&db, paths[0]) != 0) {
+    fprintf(stderr, "%s: can't open %s\n", argv[0], paths[0]);
+    return(1);
+  }
+  if (!(fp = fopen(paths[1], "w"))) {
+    perror(paths[1]);
+    citydb_close(&db);
+    return(1);
+  }
+
+  for (i = 0; i < db.header->num_cities; i++) {
+    if (wanted(&db, &db.cities[i], min_population)) {
+      num_cities++;
+    }
+  }
+  fprintf(fp, "CITYIDX %d %u %u\n", INDEX_VERSION, db.header->num_observatories, num_cities);
+  for (i = 0; i < db.header->num_observatories; i++) {
+    const cityRecord *r = &db.observatories[i];
+    fprintf(fp, "%.*s\t%s\t%s\n", (int)r->key_len, pool_string(&db, r->key),
+            pool_string(&db, r->name), pool_string(&db, r->longitude));
+  }
+  for (i = 0; i < db.header->num_cities; i++) {
+    const cityRecord *r = &db.cities[i];
+    const char *key = db.strings + r->key;
+    const char *name = pool_string(&db, r->name);
+    size_t shared = 0, title;
+    if (!wanted(&db, r, min_population)) {
+      continue;
+    }
+    while ((shared < MAX_SHARED) && (shared < previous_len) && (shared < r->key_len) &&
+           (previous[shared] == key[shared])) {
+      shared++;
+    }
+    title = title_case_length(key, r->key_len, name);
+    fprintf(fp, "%c%.*s\t%s%s\t%s\t", (char)('0' + shared), (int)(r->key_len - shared),
+            key + shared, title ? "*" : "", name + title, pool_string(&db, r->longitude));
+    put_base36(fp, r->population);
+    fputc('\n', fp);
+    previous = key;
+    previous_len = r->key_len;
+  }
+  size = ftell(fp);
+  if (fclose(fp) != 0) {
+    perror(paths[1]);
+    citydb_close(&db);
+    return(1);
+  }
+  fprintf(stderr, "%s: %u observatories and %u of %u places, %ld bytes\n", argv[0],
+          db.header->num_observatories, num_cities, db.header->num_cities, size);
+  citydb_close(&db);
+  return(0);
+}
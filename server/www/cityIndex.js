@@ -0,0 +1,218 @@
+// The city index the configuration page searches by itself, made by
+// mkcityindex (see server/citylookup/mkcityindex.c for the format). It's
+// fetched once and kept on the phone, in IndexedDB where there is one and in
+// localStorage otherwise, so searching works with no connection at all. A
+// search that finds nothing here goes to the server, which has every place.
+//
+// Searches give the same answers as citylookupd: an exact observatory name
+// gives just that observatory; otherwise places whose names start with the
+// query, exact matches first, then by population.
+var cityIndex = (function() {
+    var FORMAT = 'CITYIDX 1';
+    var MAX_RESULTS = 50;
+    // Fetch the index again after this long, in case it's been rebuilt.
+    var MAX_AGE_MS = 30 * 24 * 3600 * 1000;
+    var STORE_NAME = 'cityIndex';
+
+    var titleCase = function(key) {
+	return key.replace(/(^|[ \-])([a-z])/g, function(m, before, c) {
+	    return before + c.toUpperCase();
+	});
+    };
+
+    // The name to show for city i, with its key put back if it starts with it.
+    var displayName = function(index, i) {
+	var name = index.names[i];
+	return (name.charAt(0) === '*') ? titleCase(index.keys[i]) + name.substring(1) : name;
+    };
+
+    // Split the text up into arrays, undoing the front coding of the keys.
+    var parse = function(text) {
+	var lines = text.split('\n');
+	var header = lines[0].split(' ');
+	if ((header[0] + ' ' + header[1]) !== FORMAT) {
+	    return null;
+	}
+	var numObservatories = parseInt(header[2], 10);
+	var numCities = parseInt(header[3], 10);
+	var index = {
+	    'observatories': {},
+	    'keys': new Array(numCities),
+	    'names': new Array(numCities),
+	    'longitudes': new Array(numCities),
+	    'populations': new Array(numCities)
+	};
+	var i, f;
+	for (i = 0; i < numObservatories; i++) {
+	    f = lines[1 + i].split('\t');
+	    index.observatories[f[0]] = { 'name': f[1], 'longitude': f[2] };
+	}
+	var key = '';
+	for (i = 0; i < numCities; i++) {
+	    f = lines[1 + numObservatories + i].split('\t');
+	    key = key.substring(0, f[0].charCodeAt(0) - 48) + f[0].substring(1);
+	    index.keys[i] = key;
+	    index.names[i] = f[1];
+	    index.longitudes[i] = f[2];
+	    index.populations[i] = parseInt(f[3], 36);
+	}
+	return index;
+    };
+
+    // The first key not less than the query.
+    var lowerBound = function(keys, query) {
+	var lo = 0, hi = keys.length;
+	while (lo < hi) {
+	    var mid = (lo + hi) >>> 1;
+	    if (keys[mid] < query) {
+		lo = mid + 1;
+	    } else {
+		hi = mid;
+	    }
+	}
+	return lo;
+    };
+
+    // Search the index, giving { name: [...], longitude: [...] } just as the
+    // server does, or null if nothing matched.
+    var search = function(index, query, maxResults) {
+	var q = query.trim().toLowerCase();
+	maxResults = maxResults || MAX_RESULTS;
+	if (!index || q.length === 0) {
+	    return null;
+	}
+	if (index.observatories.hasOwnProperty(q)) {
+	    return { 'name': [ index.observatories[q].name ],
+		     'longitude': [ index.observatories[q].longitude ] };
+	}
+
+	// Walk the matches, keeping the best few in rank order.
+	var best = [];
+	var ranksAbove = function(a, b) {
+	    var aExact = (index.keys[a].length === q.length);
+	    var bExact = (index.keys[b].length === q.length);
+	    if (aExact !== bExact) {
+		return aExact;
+	    }
+	    return index.populations[a] > index.populations[b];
+	};
+	for (var i = lowerBound(index.keys, q);
+	     (i < index.keys.length) && (index.keys[i].lastIndexOf(q, 0) === 0); i++) {
+	    if ((best.length === maxResults) && !ranksAbove(i, best[best.length - 1])) {
+		continue;
+	    }
+	    var j = (best.length < maxResults) ? best.length : best.length - 1;
+	    while ((j > 0) && ranksAbove(i, best[j - 1])) {
+		best[j] = best[j - 1];
+		j--;
+	    }
+	    best[j] = i;
+	}
+	if (best.length === 0) {
+	    return null;
+	}
+	var result = { 'name': [], 'longitude': [] };
+	for (var k = 0; k < best.length; k++) {
+	    result.name.push(displayName(index, best[k]));
+	    result.longitude.push(parseFloat(index.longitudes[best[k]]));
+	}
+	return result;
+    };
+
+    // Where we keep the text between visits: IndexedDB if we can, else
+    // localStorage (which may be too small for it), else nowhere.
+    var openDatabase = function(callback) {
+	var request;
+	try {
+	    request = window.indexedDB.open('siderealConfig', 1);
+	} catch (e) {
+	    callback(null);
+	    return;
+	}
+	request.onupgradeneeded = function() {
+	    request.result.createObjectStore(STORE_NAME);
+	};
+	request.onsuccess = function() {
+	    callback(request.result);
+	};
+	request.onerror = function() {
+	    callback(null);
+	};
+    };
+
+    var readStored = function(callback) {
+	openDatabase(function(db) {
+	    if (!db) {
+		var stored = null;
+		try {
+		    stored = JSON.parse(localStorage[STORE_NAME] || 'null');
+		} catch (e) {
+		}
+		callback(stored);
+		return;
+	    }
+	    var request = db.transaction(STORE_NAME, 'readonly').objectStore(STORE_NAME).get('index');
+	    request.onsuccess = function() {
+		callback(request.result || null);
+	    };
+	    request.onerror = function() {
+		callback(null);
+	    };
+	});
+    };
+
+    var writeStored = function(stored) {
+	openDatabase(function(db) {
+	    if (db) {
+		db.transaction(STORE_NAME, 'readwrite').objectStore(STORE_NAME).put(stored, 'index');
+		return;
+	    }
+	    try {
+		localStorage[STORE_NAME] = JSON.stringify(stored);
+	    } catch (e) {
+		// Too big; we'll fetch it again next time.
+	    }
+	});
+    };
+
+    var fetchText = function(url, callback) {
+	var xhr = new XMLHttpRequest();
+	xhr.open('GET', url);
+	xhr.onload = function() {
+	    callback((xhr.status === 200) ? xhr.responseText : null);
+	};
+	xhr.onerror = function() {
+	    callback(null);
+	};
+	xhr.send();
+    };
+
+    // Get the index, from the phone if it's there, and from url otherwise
+    // or once it's old. callback gets the index, or null if there's none.
+    var load = function(url, callback) {
+	readStored(function(stored) {
+	    var index = stored ? parse(stored.text) : null;
+	    if (index) {
+		callback(index);
+	    }
+	    if (index && (Date.now() - stored.fetched < MAX_AGE_MS)) {
+		return;
+	    }
+	    fetchText(url, function(text) {
+		var fresh = text ? parse(text) : null;
+		if (fresh) {
+		    writeStored({ 'fetched': Date.now(), 'text': text });
+		}
+		if (!index) {
+		    callback(fresh);
+		}
+	    });
+	});
+    };
+
+    return { 'parse': parse, 'search': search, 'displayName': displayName, 'load': load };
+})();
+
+if (typeof module !== 'undefined') {
+    module.exports = cityIndex;
+}
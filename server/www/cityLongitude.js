@@ -2,12 +2,75 @@ require( [ "dojo/dom", "dojo/dom-attr", "dojo/dom-construct", "dojo/on", "dojo/d
 	   "dojo/window", "dojo/keys" ],
 	 function(dom, domAttr, domConstruct, on, domClass, xhr, window, keys) {
 	     
+	     // The watch can show the LST for this many sites.
+	     var maxSites = 4;
+	     // The site that a search result fills in.
+	     var currentSite = 0;
+
+	     // Parse [+-]a:b:c into a, plus b/60, plus c/3600.
+	     var parseSexagesimal = function(s) {
+		 var parts = s.replace(/^[+-]/, '').split(':');
+		 var value = 0;
+		 for (var i = parts.length - 1; i >= 0; i--) {
+		     value = value / 60 + parseFloat(parts[i]);
+		 }
+		 return (s.charAt(0) === '-') ? -value : value;
+	     };
+
+	     // The sources, one a line: name, RA, Dec, elevation limit.
+	     var getSources = function() {
+		 var lines = domAttr.get('sources-value', 'value').split('\n');
+		 var sources = [];
+		 for (var i = 0; i < lines.length; i++) {
+		     var f = lines[i].trim().split(/\s+/);
+		     if (f.length < 3) {
+			 continue;
+		     }
+		     var source = {
+			 'name': f[0].substring(0, 7),
+			 'ra': parseSexagesimal(f[1]),
+			 'dec': parseSexagesimal(f[2]),
+			 'elevation': (f.length > 3) ? parseFloat(f[3]) : 0
+		     };
+		     if (!isNaN(source.ra) && !isNaN(source.dec) && !isNaN(source.elevation)) {
+			 sources.push(source);
+		     }
+		 }
+		 return sources;
+	     };
+
 	     var getConfigData = function() {
+		 var sites = [];
+		 var saved = [];
+		 for (var i = 0; i < maxSites; i++) {
+		     var name = domAttr.get('site-name-' + i, 'value');
+		     var longitude = domAttr.get('longitude-value-' + i, 'value');
+		     var latitude = domAttr.get('latitude-value-' + i, 'value');
+		     saved.push({ 'name': name, 'longitude': longitude, 'latitude': latitude });
+		     if (!isNaN(parseFloat(longitude))) {
+			 sites.push({
+			     'name': name,
+			     'longitude': Math.floor(parseFloat(longitude) * 1e7),
+			     'latitude': isNaN(parseFloat(latitude)) ? 0 :
+				 Math.floor(parseFloat(latitude) * 1e7)
+			 });
+		     }
+		 }
+		 var dut1 = parseFloat(domAttr.get('dut1-value', 'value'));
+		 var seconds = parseInt(domAttr.get('seconds-value', 'value'), 10);
 		 var options = {
-		     'longitude': Math.floor(parseFloat(domAttr.get('longitude-value', 'value')) * 1e7)
+		     // Older watch apps only know about the one longitude.
+		     'longitude': (sites.length > 0) ? sites[0].longitude : 0,
+		     'sites': sites,
+		     'dut1': isNaN(dut1) ? 0 : dut1,
+		     'seconds_timeout': isNaN(seconds) ? 0 : Math.max(0, Math.min(255, seconds)),
+		     'sources': getSources()
 		 };
 		 // Save for next launch.
-		 localStorage['longitude'] = domAttr.get('longitude-value', 'value');
+		 localStorage['sites'] = JSON.stringify(saved);
+		 localStorage['sources'] = domAttr.get('sources-value', 'value');
+		 localStorage['dut1'] = domAttr.get('dut1-value', 'value');
+		 localStorage['seconds'] = domAttr.get('seconds-value', 'value');
 		 return options;
 	     };
 
@@ -28,36 +91,69 @@ require( [ "dojo/dom", "dojo/dom-attr", "dojo/dom-construct", "dojo/on", "dojo/d
 		 document.location = return_to + encodeURIComponent(JSON.stringify(getConfigData()));
 	     });
 
-	     var longitudeHandler_gen = function(lng) {
+	     var longitudeHandler_gen = function(name, lng) {
 		 return function() {
-		     domAttr.set('longitude-value', 'value', lng);
+		     domAttr.set('longitude-value-' + currentSite, 'value', lng);
+		     // Name the site after the place, unless it already has a name.
+		     if (!domAttr.get('site-name-' + currentSite, 'value')) {
+			 domAttr.set('site-name-' + currentSite, 'value',
+				     name.split(' (')[0].substring(0, 7));
+		     }
 		     window.scrollIntoView(dom.byId('submit-button'));
 		 };
 	     };
 
+	     var siteFocus_gen = function(site) {
+		 return function() {
+		     currentSite = site;
+		 };
+	     };
+	     for (var i = 0; i < maxSites; i++) {
+		 on(dom.byId('site-name-' + i), 'focus', siteFocus_gen(i));
+		 on(dom.byId('longitude-value-' + i), 'focus', siteFocus_gen(i));
+		 on(dom.byId('latitude-value-' + i), 'focus', siteFocus_gen(i));
+	     }
+
+	     var showLocations = function(d) {
+		 if (d && typeof d.name !== 'undefined') {
+		     domConstruct.empty('location-container');
+		     // Show the locations.
+		     for (var i = 0; i < d.name.length; i++) {
+			 var l = domConstruct.create('label', {
+			     'class': "item clickme",
+			     'innerHTML': d.name[i]
+			 }, dom.byId('location-container'));
+			 on(l, 'click', longitudeHandler_gen(d.name[i], d.longitude[i]));
+		     }
+		     domClass.remove('location-wrapper', 'hidden');
+		 } else {
+		     domClass.add('location-wrapper', 'hidden');
+		 }
+	     };
+
+	     // The index kept on the phone, once it's loaded (see cityIndex.js).
+	     var localIndex = null;
+	     cityIndex.load('cities.idx', function(index) {
+		 localIndex = index;
+	     });
+
 	     var searchForLocation = function(e) {
+		 var query = domAttr.get('input-site-search', 'value');
+		 // Search on the phone first; only the places it doesn't know
+		 // about need the server.
+		 var found = cityIndex.search(localIndex, query);
+		 if (found) {
+		     showLocations(found);
+		     return;
+		 }
 		 xhr("http://astrowebservices.com/~ste616/cgi-bin/cityLongitude.pl", {
 		     'handleAs': "json",
 		     'query': {
-			 'location': domAttr.get('input-site-search', 'value')
+			 'location': query
 		     }
 		 }).then(function(d) {
 		     console.log(d);
-		     if (typeof d !== 'undefined' &&
-			 typeof d.name !== 'undefined') {
-			 domConstruct.empty('location-container');
-			 // Show the locations.
-			 for (var i = 0; i < d.name.length; i++) {
-			     var l = domConstruct.create('label', {
-				 'class': "item clickme",
-				 'innerHTML': d.name[i]
-			     }, dom.byId('location-container'));
-			     on(l, 'click', longitudeHandler_gen(d.longitude[i]));
-			 }
-			 domClass.remove('location-wrapper', 'hidden');
-		     } else {
-			 domClass.add('location-wrapper', 'hidden');
-		     }
+		     showLocations(d);
 		 }, function(de) {
 		     console.log('error');
 		     console.log(de);
@@ -72,7 +168,24 @@ require( [ "dojo/dom", "dojo/dom-attr", "dojo/dom-construct", "dojo/on", "dojo/d
 		 }
 	     });
 
-	     if (localStorage['longitude']) {
-		 domAttr.set('longitude-value', 'value', localStorage['longitude']);
+	     if (localStorage['sites']) {
+		 var saved = JSON.parse(localStorage['sites']);
+		 for (var i = 0; (i < saved.length) && (i < maxSites); i++) {
+		     domAttr.set('site-name-' + i, 'value', saved[i].name);
+		     domAttr.set('longitude-value-' + i, 'value', saved[i].longitude);
+		     domAttr.set('latitude-value-' + i, 'value', saved[i].latitude || '');
+		 }
+	     } else if (localStorage['longitude']) {
+		 // Saved by the page from before there were several sites.
+		 domAttr.set('longitude-value-0', 'value', localStorage['longitude']);
+	     }
+	     if (localStorage['sources']) {
+		 domAttr.set('sources-value', 'value', localStorage['sources']);
+	     }
+	     if (localStorage['dut1']) {
+		 domAttr.set('dut1-value', 'value', localStorage['dut1']);
+	     }
+	     if (localStorage['seconds']) {
+		 domAttr.set('seconds-value', 'value', localStorage['seconds']);
 	     }
 	 });
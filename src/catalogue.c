@@ -0,0 +1,307 @@
+#include "catalogue.h"
+#include "settings.h"
+#include "instrument.h"
+
+// Solar minutes in one turn of hour angle (one sidereal day), scaled by 2^8.
+#define SOLAR_MINUTES_PER_TURN_Q8 367633ULL
+
+// The most sources catalogue_update will rank at once.
+#define MAX_TOP 8
+
+// The rise hour angle of each source, in units of 2^-16 turns (the Pebble
+// trigonometry's units), or one of these.
+#define RISE_NEVER 0xFFFF
+#define RISE_ALWAYS 0xFFFE
+
+// The persistent storage keys for a catalogue from the phone: its size, and
+// then its contents, a block to a key. The settings use keys below these.
+#define PERSIST_KEY_CATALOGUE_SIZE 16
+#define PERSIST_KEY_CATALOGUE 17
+
+// The catalogue as loaded, header and all, and its records.
+static uint8_t *s_data = NULL;
+static size_t s_data_size = 0;
+static catalogueSource *s_sources = NULL;
+static int s_num_sources = 0;
+
+// The rise hour angles for each site, worked out when first needed, and the
+// latitude they were worked out for.
+static uint16_t *s_rise_hour_angles = NULL;
+static bool s_rise_valid[MAX_SITES];
+static int32_t s_rise_latitude_e7[MAX_SITES];
+
+// Is this a catalogue we can read? Passes back its header if so.
+static bool catalogue_valid(const uint8_t *data, size_t size, catalogueHeader *header) {
+  if (size < sizeof(catalogueHeader)) {
+    return(false);
+  }
+  memcpy(header, data, sizeof(catalogueHeader));
+  return((memcmp(header->magic, CATALOGUE_MAGIC, sizeof(header->magic)) == 0) &&
+         (header->record_size == sizeof(catalogueSource)) &&
+         (size == sizeof(catalogueHeader) + header->num_sources * sizeof(catalogueSource)));
+}
+
+// The size of the catalogue from the phone in flash, or 0 if there isn't one.
+static size_t stored_size(void) {
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+  if (!persist_exists(PERSIST_KEY_CATALOGUE_SIZE)) {
+    return(0);
+  }
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+  return((size_t)persist_read_int(PERSIST_KEY_CATALOGUE_SIZE));
+}
+
+// Delete the blocks a stored catalogue of old_size used past those one of
+// new_size needs.
+static void delete_blocks(size_t old_size, size_t new_size) {
+  uint32_t key = PERSIST_KEY_CATALOGUE +
+                 (uint32_t)((new_size + PERSIST_DATA_MAX_LENGTH - 1) / PERSIST_DATA_MAX_LENGTH);
+  uint32_t end = PERSIST_KEY_CATALOGUE +
+                 (uint32_t)((old_size + PERSIST_DATA_MAX_LENGTH - 1) / PERSIST_DATA_MAX_LENGTH);
+  for (; key < end; key++) {
+    INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+    persist_delete(key);
+  }
+}
+
+// Read a catalogue from the phone back out of flash.
+static uint8_t *read_stored(size_t *size) {
+  uint8_t *data;
+  size_t offset;
+  uint32_t key = PERSIST_KEY_CATALOGUE;
+  *size = stored_size();
+  if ((*size == 0) || !(data = malloc(*size))) {
+    return(NULL);
+  }
+  for (offset = 0; offset < *size; offset += PERSIST_DATA_MAX_LENGTH) {
+    size_t n = *size - offset;
+    if (n > PERSIST_DATA_MAX_LENGTH) {
+      n = PERSIST_DATA_MAX_LENGTH;
+    }
+    INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+    if (persist_read_data(key++, data + offset, n) != (int)n) {
+      free(data);
+      return(NULL);
+    }
+  }
+  return(data);
+}
+
+// Read the built-in catalogue from its resource.
+static uint8_t *read_resource(size_t *size) {
+  ResHandle handle = resource_get_handle(RESOURCE_ID_CATALOGUE);
+  uint8_t *data;
+  *size = handle ? resource_size(handle) : 0;
+  if ((*size == 0) || !(data = malloc(*size))) {
+    return(NULL);
+  }
+  resource_load_byte_range(handle, 0, data, *size);
+  return(data);
+}
+
+void catalogue_load(void) {
+  catalogueHeader header;
+  size_t size = 0;
+  uint8_t *data;
+  int i;
+  catalogue_unload();
+  data = read_stored(&size);
+  if (!data) {
+    data = read_resource(&size);
+  }
+  if (!data) {
+    return;
+  }
+  if (!catalogue_valid(data, size, &header)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "catalogue is not one we can read");
+    free(data);
+    return;
+  }
+  s_rise_hour_angles = malloc(MAX_SITES * header.num_sources * sizeof(uint16_t));
+  if (!s_rise_hour_angles) {
+    free(data);
+    return;
+  }
+  // The header is 8 bytes, so the records after it are aligned.
+  s_data = data;
+  s_data_size = size;
+  s_sources = (catalogueSource *)(data + sizeof(catalogueHeader));
+  for (i = 0; i < header.num_sources; i++) {
+    s_sources[i].name[CATALOGUE_NAME_LENGTH - 1] = '\0';
+  }
+  s_num_sources = header.num_sources;
+}
+
+void catalogue_unload(void) {
+  free(s_data);
+  free(s_rise_hour_angles);
+  s_data = NULL;
+  s_data_size = 0;
+  s_sources = NULL;
+  s_rise_hour_angles = NULL;
+  s_num_sources = 0;
+  memset(s_rise_valid, 0, sizeof(s_rise_valid));
+}
+
+bool catalogue_store(const uint8_t *data, size_t size) {
+  catalogueHeader header;
+  size_t offset, old_size;
+  uint32_t key = PERSIST_KEY_CATALOGUE;
+  if ((size > 0) && !catalogue_valid(data, size, &header)) {
+    return(false);
+  }
+  // An empty catalogue, or one with no sources in it, means the resource.
+  if ((size == 0) || (header.num_sources == 0)) {
+    old_size = stored_size();
+    if (old_size == 0) {
+      return(true);
+    }
+    delete_blocks(old_size, 0);
+    INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+    persist_delete(PERSIST_KEY_CATALOGUE_SIZE);
+    catalogue_load();
+    return(true);
+  }
+  if ((size == s_data_size) && (memcmp(data, s_data, size) == 0)) {
+    return(true);
+  }
+  // A smaller catalogue leaves none of the last one's blocks behind.
+  delete_blocks(stored_size(), size);
+  for (offset = 0; offset < size; offset += PERSIST_DATA_MAX_LENGTH) {
+    size_t n = size - offset;
+    if (n > PERSIST_DATA_MAX_LENGTH) {
+      n = PERSIST_DATA_MAX_LENGTH;
+    }
+    INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+    persist_write_data(key++, data + offset, n);
+  }
+  INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+  persist_write_int(PERSIST_KEY_CATALOGUE_SIZE, (int32_t)size);
+  catalogue_load();
+  return(true);
+}
+
+int catalogue_count(void) {
+  return(s_num_sources);
+}
+
+static int32_t isqrt(int32_t n) {
+  int32_t root = 0, bit = 1 << 30;
+  while (bit > n) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return(root);
+}
+
+// The hour angle at which a source crosses its elevation limit, from
+//   cos H = (sin el - sin lat sin dec) / (cos lat cos dec).
+static uint16_t rise_hour_angle(const catalogueSource *source, int32_t latitude) {
+  int64_t sin_lat = sin_lookup(latitude), cos_lat = cos_lookup(latitude);
+  int64_t sin_dec = sin_lookup(source->dec >> 16), cos_dec = cos_lookup(source->dec >> 16);
+  int64_t sin_el = sin_lookup(source->elevation_limit >> 16);
+  int64_t numerator = sin_el * TRIG_MAX_RATIO - sin_lat * sin_dec;
+  int64_t denominator = cos_lat * cos_dec;
+  int32_t c, s, angle;
+  if (numerator >= denominator) {
+    return(RISE_NEVER);
+  }
+  if (numerator <= -denominator) {
+    return(RISE_ALWAYS);
+  }
+  // Scale cos H to fit atan2_lookup, which takes 16 bits; it's strictly
+  // between -1 and 1 by now. At 2^14, sin H can reach the scale itself
+  // (when cos H is 0) and still fit.
+  c = (int32_t)((numerator << 14) / denominator);
+  s = isqrt((1 << 28) - c * c);
+  angle = atan2_lookup((int16_t)s, (int16_t)c);
+  return((angle >= TRIG_MAX_ANGLE / 2) ? RISE_ALWAYS : (uint16_t)angle);
+}
+
+static const uint16_t *site_rise_hour_angles(int site, int32_t latitude_e7) {
+  uint16_t *rise = s_rise_hour_angles + site * s_num_sources;
+  if (!s_rise_valid[site] || (s_rise_latitude_e7[site] != latitude_e7)) {
+    // Degrees * 1e7 to 2^-16 turns.
+    int32_t latitude = (int32_t)((int64_t)latitude_e7 * TRIG_MAX_ANGLE / 3600000000LL);
+    int i;
+    for (i = 0; i < s_num_sources; i++) {
+      rise[i] = rise_hour_angle(&s_sources[i], latitude);
+    }
+    s_rise_valid[site] = true;
+    s_rise_latitude_e7[site] = latitude_e7;
+  }
+  return(rise);
+}
+
+// How pressing a source is: lower is more so.
+static uint32_t status_rank(const sourceStatus *status) {
+  switch (status->state) {
+  case SOURCE_UP:
+    return((uint32_t)status->minutes);
+  case SOURCE_ALWAYS_UP:
+    return(0x40000000);
+  default:
+    return(0x80000000 + (uint32_t)status->minutes);
+  }
+}
+
+int catalogue_update(int site, int32_t latitude_e7, uint32_t lst, sourceStatus *top, int max_top) {
+  uint32_t ranks[MAX_TOP];
+  const uint16_t *rise;
+  int num_top = 0, i, j;
+  if (!s_sources || (site < 0) || (site >= MAX_SITES) || (max_top <= 0)) {
+    return(0);
+  }
+  if (max_top > MAX_TOP) {
+    max_top = MAX_TOP;
+  }
+  rise = site_rise_hour_angles(site, latitude_e7);
+
+  for (i = 0; i < s_num_sources; i++) {
+    sourceStatus status;
+    uint32_t rank;
+    if (rise[i] == RISE_NEVER) {
+      continue;
+    }
+    status.source = &s_sources[i];
+    status.hour_angle = (int32_t)(lst - s_sources[i].ra);
+    if (rise[i] == RISE_ALWAYS) {
+      status.state = SOURCE_ALWAYS_UP;
+      status.minutes = 0;
+    } else {
+      int32_t limit = (int32_t)rise[i] << 16;
+      uint32_t until;
+      if ((status.hour_angle > -limit) && (status.hour_angle < limit)) {
+        status.state = SOURCE_UP;
+        until = (uint32_t)(limit - status.hour_angle);
+      } else {
+        status.state = SOURCE_DOWN;
+        until = (uint32_t)(-limit) - (uint32_t)status.hour_angle;
+      }
+      status.minutes = (int32_t)(((uint64_t)until * SOLAR_MINUTES_PER_TURN_Q8) >> 40);
+    }
+
+    // Keep the most pressing few in order.
+    rank = status_rank(&status);
+    if ((num_top == max_top) && (rank >= ranks[num_top - 1])) {
+      continue;
+    }
+    j = (num_top < max_top) ? num_top++ : num_top - 1;
+    while ((j > 0) && (rank < ranks[j - 1])) {
+      top[j] = top[j - 1];
+      ranks[j] = ranks[j - 1];
+      j--;
+    }
+    top[j] = status;
+    ranks[j] = rank;
+  }
+  return(num_top);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <pebble.h>
+
+// A catalogue of sources to keep an eye on, so the face can say which are up
+// and when they rise or set.
+//
+// The catalogue is the CATALOGUE raw resource: a catalogueHeader followed by
+// its packed records, built from resources/data/catalogue.txt by
+// host/mkcatalogue. The phone can send another in the same form. Angles
+// are fractions of a turn in units of 2^-32 turns, the top half of the
+// face's own turns_t, so an hour angle is just LST - RA with natural
+// wrapping.
+
+#define CATALOGUE_MAGIC "CAT1"
+#define CATALOGUE_NAME_LENGTH 8
+
+typedef struct _catalogue_header {
+  char magic[4];
+  uint16_t num_sources;
+  uint16_t record_size;
+} catalogueHeader;
+
+typedef struct _catalogue_source {
+  char name[CATALOGUE_NAME_LENGTH];
+  // Right ascension, from 0 to 1 turn.
+  uint32_t ra;
+  // Declination, and the lowest elevation it can be observed at, each from
+  // -1/4 to 1/4 turn.
+  int32_t dec;
+  int32_t elevation_limit;
+} catalogueSource;
+
+// Where a source is at the moment.
+typedef enum {
+  SOURCE_UP,
+  SOURCE_ALWAYS_UP,
+  SOURCE_DOWN
+} sourceState;
+
+typedef struct _source_status {
+  const catalogueSource *source;
+  sourceState state;
+  // The hour angle, from -1/2 to 1/2 turn.
+  int32_t hour_angle;
+  // Minutes of solar time until it sets (if up) or rises (if down).
+  int32_t minutes;
+} sourceStatus;
+
+// Load the catalogue, or unload it. A catalogue sent from the phone takes
+// the place of the resource; the catalogue is empty if there's neither.
+void catalogue_load(void);
+void catalogue_unload(void);
+int catalogue_count(void);
+
+// Keep a catalogue sent from the phone, in the same form as the resource,
+// and load it; an empty one, or one with no sources, goes back to the
+// resource. It's only written to flash if it differs from the one loaded.
+// Returns false, and leaves things as they were, if it isn't a catalogue we
+// can read.
+bool catalogue_store(const uint8_t *data, size_t size);
+
+// Work out where every source is for a site at the given LST (in 2^-32
+// turns), and pass back the most pressing few: those up, soonest to set
+// first, then those yet to rise, soonest first. Returns how many it passed
+// back.
+//
+// The rise and set hour angles need trigonometry, so they're worked out the
+// first time a site is asked about (or its latitude changes) and kept; after
+// that each source costs a subtraction and a multiplication.
+int catalogue_update(int site, int32_t latitude_e7, uint32_t lst, sourceStatus *top, int max_top);
@@ -0,0 +1,125 @@
+#include "config.h"
+#include "settings.h"
+#include "catalogue.h"
+
+// The payload as it arrives, and how much of it has.
+static uint8_t *s_payload = NULL;
+static uint16_t s_payload_length = 0;
+static uint16_t s_received = 0;
+
+static void discard_payload(void) {
+  free(s_payload);
+  s_payload = NULL;
+  s_payload_length = 0;
+  s_received = 0;
+}
+
+uint32_t config_inbox_size(void) {
+  return(dict_calc_buffer_size(1, sizeof(configChunkHeader) + CONFIG_CHUNK_DATA));
+}
+
+uint32_t config_outbox_size(void) {
+  return(dict_calc_buffer_size(1, sizeof(int32_t)));
+}
+
+// Check a whole payload over, and make the settings and catalogue follow it.
+static configError apply_payload(void) {
+  configPayloadHeader header;
+  Settings settings = *settings_get();
+  const configSite *sites;
+  size_t sites_length;
+  int i;
+  if (s_payload_length < sizeof(header)) {
+    return(CONFIG_ERROR_INVALID);
+  }
+  memcpy(&header, s_payload, sizeof(header));
+  sites_length = header.num_sites * sizeof(configSite);
+  if (header.version != CONFIG_VERSION) {
+    return(CONFIG_ERROR_VERSION);
+  }
+  if ((header.num_sites < 1) || (header.num_sites > MAX_SITES) ||
+      (header.catalogue_length > CONFIG_MAX_CATALOGUE) ||
+      (sizeof(header) + sites_length + header.catalogue_length != s_payload_length)) {
+    return(CONFIG_ERROR_INVALID);
+  }
+
+  if (header.flags & CONFIG_HAS_CATALOGUE) {
+    if (!catalogue_store(s_payload + sizeof(header) + sites_length, header.catalogue_length)) {
+      return(CONFIG_ERROR_INVALID);
+    }
+  }
+
+  // The sites are a multiple of 4 bytes into the payload, but the payload
+  // itself came from malloc, so they're aligned.
+  sites = (const configSite *)(s_payload + sizeof(header));
+  memset(settings.sites, 0, sizeof(settings.sites));
+  memset(settings.latitudes_e7, 0, sizeof(settings.latitudes_e7));
+  settings.num_sites = header.num_sites;
+  for (i = 0; i < header.num_sites; i++) {
+    settings.sites[i].longitude_e7 = sites[i].longitude_e7;
+    settings.latitudes_e7[i] = sites[i].latitude_e7;
+    memcpy(settings.sites[i].name, sites[i].name, SITE_NAME_LENGTH - 1);
+  }
+  settings.dut1_ms = header.dut1_ms;
+  settings.seconds_timeout_s = header.seconds_timeout_s;
+  settings_update(&settings);
+  return(CONFIG_OK);
+}
+
+configStatus config_receive(const uint8_t *chunk, size_t length, int32_t *ack) {
+  configChunkHeader header;
+  size_t data_length;
+  configError error;
+  if (length < sizeof(header)) {
+    *ack = CONFIG_ERROR_INVALID;
+    return(CONFIG_REJECTED);
+  }
+  memcpy(&header, chunk, sizeof(header));
+  data_length = length - sizeof(header);
+  if (header.version != CONFIG_VERSION) {
+    *ack = CONFIG_ERROR_VERSION;
+    return(CONFIG_REJECTED);
+  }
+  if (header.total_length > sizeof(configPayloadHeader) + MAX_SITES * sizeof(configSite) +
+      CONFIG_MAX_CATALOGUE) {
+    *ack = CONFIG_ERROR_TOO_LONG;
+    return(CONFIG_REJECTED);
+  }
+
+  // The first chunk (re)starts a payload.
+  if (header.offset == 0) {
+    discard_payload();
+    s_payload = malloc(header.total_length);
+    if (!s_payload) {
+      *ack = CONFIG_ERROR_NO_MEMORY;
+      return(CONFIG_REJECTED);
+    }
+    s_payload_length = header.total_length;
+  }
+  if (!s_payload || (header.total_length != s_payload_length)) {
+    // Part of a payload we never saw the start of; have the phone start over.
+    *ack = 0;
+    return(CONFIG_PENDING);
+  }
+
+  // Take the chunk if it's the next one. Anything else is a resend of one we
+  // already have, or follows one that went missing; either way the ack tells
+  // the phone where to carry on from.
+  if ((header.offset == s_received) &&
+      (data_length <= (size_t)(s_payload_length - s_received))) {
+    memcpy(s_payload + s_received, chunk + sizeof(header), data_length);
+    s_received += data_length;
+  }
+  *ack = s_received;
+  if (s_received < s_payload_length) {
+    return(CONFIG_PENDING);
+  }
+
+  error = apply_payload();
+  discard_payload();
+  if (error != CONFIG_OK) {
+    *ack = error;
+    return(CONFIG_REJECTED);
+  }
+  return(CONFIG_APPLIED);
+}
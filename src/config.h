@@ -0,0 +1,83 @@
+#pragma once
+
+#include <pebble.h>
+
+// The configuration protocol. The phone sends every setting at once, as one
+// versioned binary payload split into chunks that each fit in one
+// AppMessage, so the watch only needs buffers for a single chunk:
+//
+//   KEY_CONFIG_CHUNK  a configChunkHeader, then up to CONFIG_CHUNK_DATA
+//                     bytes of the payload starting at header.offset.
+//   KEY_CONFIG_ACK    the watch's answer to each chunk: how many bytes of
+//                     the payload it now holds, so the phone sends the next
+//                     chunk from there (or resends one that went missing),
+//                     or a negative configError if it can't take it.
+//
+// The payload is a configPayloadHeader, then num_sites configSites, then
+// catalogue_length bytes of catalogue in the same form as the CATALOGUE
+// resource. Everything is little-endian.
+
+#define KEY_CONFIG_CHUNK 40
+#define KEY_CONFIG_ACK 41
+
+#define CONFIG_VERSION 1
+#define CONFIG_CHUNK_DATA 120
+
+// The biggest catalogue the phone can send; it has to fit in persistent
+// storage alongside the settings.
+#define CONFIG_MAX_CATALOGUE 2048
+
+typedef struct _config_chunk_header {
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t total_length;
+  uint16_t offset;
+} configChunkHeader;
+
+// The payload comes with a catalogue (which an empty one, or one with no
+// sources, replaces with the built-in catalogue); without, the watch keeps
+// the one it has.
+#define CONFIG_HAS_CATALOGUE 0x01
+
+typedef struct _config_payload_header {
+  uint8_t version;
+  uint8_t flags;
+  uint8_t num_sites;
+  // How long the LST shows seconds after a flick, in seconds (0 for never).
+  // This was reserved, and always 0, before the seconds were added.
+  uint8_t seconds_timeout_s;
+  // UT1 - UTC, in milliseconds.
+  int16_t dut1_ms;
+  uint16_t catalogue_length;
+} configPayloadHeader;
+
+typedef struct _config_site {
+  int32_t longitude_e7;
+  int32_t latitude_e7;
+  char name[8];
+} configSite;
+
+typedef enum {
+  CONFIG_OK = 0,
+  CONFIG_ERROR_VERSION = -1,
+  CONFIG_ERROR_TOO_LONG = -2,
+  CONFIG_ERROR_INVALID = -3,
+  CONFIG_ERROR_NO_MEMORY = -4
+} configError;
+
+typedef enum {
+  // More chunks to come.
+  CONFIG_PENDING,
+  // The payload is complete, and the settings and catalogue now follow it.
+  CONFIG_APPLIED,
+  // The chunk or payload was refused.
+  CONFIG_REJECTED
+} configStatus;
+
+// The AppMessage buffer sizes the protocol needs.
+uint32_t config_inbox_size(void);
+uint32_t config_outbox_size(void);
+
+// Take one chunk, as it arrived in KEY_CONFIG_CHUNK, and pass back the ack
+// to send to the phone. The payload is only held while it's arriving.
+configStatus config_receive(const uint8_t *chunk, size_t length, int32_t *ack);
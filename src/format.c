@@ -0,0 +1,91 @@
+#include "format.h"
+
+// Every two-digit number, so each pair of digits is one lookup.
+static const char s_two_digits[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// The C locale abbreviated day names, as %a gives them.
+static const char s_day_names[] = "SunMonTueWedThuFriSat";
+
+static char *put_two_digits(char *buf, int value) {
+  buf[0] = s_two_digits[2 * value];
+  buf[1] = s_two_digits[2 * value + 1];
+  return(buf + 2);
+}
+
+// Write a non-negative integer with no padding.
+static char *put_integer(char *buf, int32_t value) {
+  char digits[FORMAT_INT32_DIGITS];
+  int n = 0;
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+  while (n > 0) {
+    *buf++ = digits[--n];
+  }
+  return(buf);
+}
+
+char *format_hhmm(char *buf, int minutes) {
+  buf = put_two_digits(buf, minutes / 60);
+  *buf++ = ':';
+  buf = put_two_digits(buf, minutes % 60);
+  *buf = '\0';
+  return(buf);
+}
+
+char *format_ss(char *buf, int seconds) {
+  buf = put_two_digits(buf, seconds);
+  *buf = '\0';
+  return(buf);
+}
+
+char *format_hmm(char *buf, int minutes) {
+  if (minutes < 0) {
+    *buf++ = '-';
+    minutes = -minutes;
+  }
+  buf = put_integer(buf, minutes / 60);
+  *buf++ = ':';
+  buf = put_two_digits(buf, minutes % 60);
+  *buf = '\0';
+  return(buf);
+}
+
+char *format_date(char *buf, const struct tm *t) {
+  int year = t->tm_year + 1900;
+  int yday = t->tm_yday + 1;
+  memcpy(buf, &s_day_names[3 * t->tm_wday], 3);
+  buf[3] = ' ';
+  buf = put_two_digits(buf + 4, year / 100);
+  buf = put_two_digits(buf, year % 100);
+  *buf++ = '-';
+  buf = put_two_digits(buf, t->tm_mon + 1);
+  *buf++ = '-';
+  buf = put_two_digits(buf, t->tm_mday);
+  memcpy(buf, " DOY ", 5);
+  buf += 5;
+  *buf++ = '0' + yday / 100;
+  buf = put_two_digits(buf, yday % 100);
+  *buf = '\0';
+  return(buf);
+}
+
+char *format_mjd(char *buf, int32_t mjd) {
+  memcpy(buf, "MJD ", 4);
+  buf = put_integer(buf + 4, mjd);
+  buf[0] = ' ';
+  buf[1] = ' ';
+  buf[2] = '\0';
+  return(buf + 2);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <pebble.h>
+
+// Allocation-free formatters for the fixed formats shown on the face. Each
+// writes a NUL-terminated string into buf and returns a pointer to the NUL,
+// so calls can be chained. They produce exactly what strftime and snprintf
+// did, without the cost of the general-purpose libc routines.
+
+// "HH:MM" from the number of minutes into the day (6 bytes).
+char *format_hhmm(char *buf, int minutes);
+
+// "SS" from the number of seconds into the minute (3 bytes).
+char *format_ss(char *buf, int seconds);
+
+// "H:MM" from a number of minutes, with the hours unpadded and any sign
+// first, such as "-1:05" (at most 7 bytes for a day either way).
+char *format_hmm(char *buf, int minutes);
+
+// "%a %Y-%m-%d DOY %j" (23 bytes).
+char *format_date(char *buf, const struct tm *t);
+
+// The most digits a non-negative int32_t has (2147483647).
+#define FORMAT_INT32_DIGITS 10
+
+// The longest format_mjd writes, with its NUL: 12 bytes for the five digit
+// MJDs of today, up to 17 for the largest int32_t.
+#define FORMAT_MJD_LENGTH (4 + FORMAT_INT32_DIGITS + 3)
+
+// "MJD %d  " from a non-negative MJD (at most FORMAT_MJD_LENGTH bytes).
+char *format_mjd(char *buf, int32_t mjd);
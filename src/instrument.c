@@ -0,0 +1,153 @@
+#include "instrument.h"
+
+#ifdef INSTRUMENT
+
+#ifdef INSTRUMENT_CLOCK_US
+// Supplied by the build.
+uint32_t INSTRUMENT_CLOCK_US(void);
+#endif
+
+static const char *const s_probe_names[NUM_PROBES] = {
+  "timer", "tap", "message", "update_time", "gmst", "format", "lst panel",
+  "flush", "draw", "latency"
+};
+
+static probeStats s_probes[NUM_PROBES];
+static instrumentSummary s_summary;
+static time_t s_started;
+// The next hour to log at.
+static time_t s_log_at;
+
+static time_t now_s(void) {
+  time_t t;
+  time_ms(&t, NULL);
+  return(t);
+}
+
+uint32_t instrument_clock_us(void) {
+#ifdef INSTRUMENT_CLOCK_US
+  return(INSTRUMENT_CLOCK_US());
+#else
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  return((uint32_t)t * 1000000 + (uint32_t)ms * 1000);
+#endif
+}
+
+void instrument_init(void) {
+  memset(s_probes, 0, sizeof(s_probes));
+  memset(&s_summary, 0, sizeof(s_summary));
+  s_started = now_s();
+  s_log_at = s_started - s_started % 3600 + 3600;
+}
+
+void instrument_record(instrumentProbe probe, uint32_t us) {
+  probeStats *stats = &s_probes[probe];
+  int bucket = 0;
+  uint32_t v = us;
+  while (v && (bucket < INSTRUMENT_BUCKETS - 1)) {
+    v >>= 1;
+    bucket++;
+  }
+  stats->count++;
+  stats->total_us += us;
+  if (us > stats->max_us) {
+    stats->max_us = us;
+  }
+  stats->buckets[bucket]++;
+}
+
+void instrument_count(instrumentCounter counter, uint32_t n) {
+  s_summary.counters[counter] += n;
+}
+
+void instrument_count_redraw(int field) {
+  s_summary.redraws[field]++;
+}
+
+// The upper bound of the bucket holding the given fraction (in percent) of
+// the times, in microseconds.
+static uint32_t percentile_us(const probeStats *stats, int percent) {
+  uint32_t wanted = (uint32_t)(((uint64_t)stats->count * percent + 99) / 100);
+  uint32_t seen = 0;
+  int bucket;
+  for (bucket = 0; bucket < INSTRUMENT_BUCKETS - 1; bucket++) {
+    seen += stats->buckets[bucket];
+    if (seen >= wanted) {
+      break;
+    }
+  }
+  return((bucket < INSTRUMENT_BUCKETS - 1) ? (1UL << bucket) : stats->max_us);
+}
+
+void instrument_log(void) {
+  const uint32_t *c = s_summary.counters;
+  int i;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "stats after %lu s: flash %lu reads %lu writes; "
+          "messages %lu in (%lu bytes, %lu dropped), %lu out (%lu bytes, %lu failed)",
+          (unsigned long)(now_s() - s_started), (unsigned long)c[COUNTER_PERSIST_READS],
+          (unsigned long)c[COUNTER_PERSIST_WRITES], (unsigned long)c[COUNTER_MESSAGES_RECEIVED],
+          (unsigned long)c[COUNTER_BYTES_RECEIVED], (unsigned long)c[COUNTER_MESSAGES_DROPPED],
+          (unsigned long)c[COUNTER_MESSAGES_SENT], (unsigned long)c[COUNTER_BYTES_SENT],
+          (unsigned long)c[COUNTER_SENDS_FAILED]);
+  for (i = 0; i < NUM_PROBES; i++) {
+    const probeStats *stats = &s_probes[i];
+    if (stats->count == 0) {
+      continue;
+    }
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "%s: %lu, mean %lu us, max %lu us, p50 < %lu us, p99 < %lu us",
+            s_probe_names[i], (unsigned long)stats->count,
+            (unsigned long)(stats->total_us / stats->count), (unsigned long)stats->max_us,
+            (unsigned long)percentile_us(stats, 50), (unsigned long)percentile_us(stats, 99));
+  }
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "redraws: local %lu date %lu dst %lu utc %lu mjd %lu lst %lu",
+          (unsigned long)s_summary.redraws[FIELD_LOCAL_TIME],
+          (unsigned long)s_summary.redraws[FIELD_LOCAL_DATE],
+          (unsigned long)s_summary.redraws[FIELD_LOCAL_DST],
+          (unsigned long)s_summary.redraws[FIELD_UTC_TIME],
+          (unsigned long)s_summary.redraws[FIELD_MJD],
+          (unsigned long)s_summary.redraws[FIELD_LST_TIME]);
+}
+
+void instrument_log_hourly(void) {
+  time_t now = now_s();
+  if (now >= s_log_at) {
+    instrument_log();
+    s_log_at = now - now % 3600 + 3600;
+  }
+}
+
+uint32_t instrument_outbox_size(void) {
+  return(dict_calc_buffer_size(1, sizeof(instrumentHeader) + sizeof(probeStats)));
+}
+
+void instrument_send(int32_t index) {
+  uint8_t record[sizeof(instrumentHeader) + sizeof(probeStats)];
+  _Static_assert(sizeof(instrumentHeader) + sizeof(instrumentSummary) <= sizeof(record),
+                 "the summary must fit in a record sized for probeStats");
+  instrumentHeader header = { INSTRUMENT_VERSION, (uint8_t)index, 1 + NUM_PROBES, 0 };
+  DictionaryIterator *out;
+  size_t length = sizeof(header);
+  if ((index < 0) || (index > NUM_PROBES)) {
+    return;
+  }
+  memcpy(record, &header, sizeof(header));
+  if (index == 0) {
+    s_summary.uptime_s = (uint32_t)(now_s() - s_started);
+    memcpy(record + length, &s_summary, sizeof(s_summary));
+    length += sizeof(s_summary);
+  } else {
+    memcpy(record + length, &s_probes[index - 1], sizeof(probeStats));
+    length += sizeof(probeStats);
+  }
+  if ((app_message_outbox_begin(&out) != APP_MSG_OK) ||
+      (dict_write_data(out, KEY_STATS, record, length) != DICT_OK) ||
+      (app_message_outbox_send() != APP_MSG_OK)) {
+    s_summary.counters[COUNTER_SENDS_FAILED]++;
+    return;
+  }
+  s_summary.counters[COUNTER_MESSAGES_SENT]++;
+  s_summary.counters[COUNTER_BYTES_SENT] += length;
+}
+
+#endif
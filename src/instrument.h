@@ -0,0 +1,130 @@
+#pragma once
+
+#include <pebble.h>
+#include "layout.h"
+
+// Counters and timers for what the face costs on the wrist: how often each
+// handler wakes us and how long it takes, the work inside update_time, each
+// field's redraws, and flash and AppMessage traffic. Everything is kept in
+// fixed tables, with times in histograms, so nothing is allocated and the
+// cost of recording is the same after a week as after a minute.
+//
+// Define INSTRUMENT to build them in. Without it, every hook below compiles
+// to nothing. A build with them logs them every hour with APP_LOG, and
+// sends them to the phone when it asks (see KEY_STATS_REQUEST).
+// #define INSTRUMENT
+
+// What the timers time.
+typedef enum {
+  PROBE_TIMER,
+  PROBE_TAP,
+  PROBE_MESSAGE,
+  PROBE_UPDATE_TIME,
+  // Within update_time: GMST, formatting the solar clocks, and working out
+  // and formatting the LST panel (which includes the sources).
+  PROBE_GMST,
+  PROBE_FORMAT,
+  PROBE_LST_PANEL,
+  // Pushing the changed fields out to their layers, and (in canvas mode)
+  // drawing the face.
+  PROBE_FLUSH,
+  PROBE_DRAW,
+  // Not a time taken, but how late each wakeup was.
+  PROBE_LATENCY,
+  NUM_PROBES
+} instrumentProbe;
+
+// What the counters count.
+typedef enum {
+  COUNTER_PERSIST_READS,
+  COUNTER_PERSIST_WRITES,
+  COUNTER_MESSAGES_RECEIVED,
+  COUNTER_BYTES_RECEIVED,
+  COUNTER_MESSAGES_DROPPED,
+  COUNTER_MESSAGES_SENT,
+  COUNTER_BYTES_SENT,
+  COUNTER_SENDS_FAILED,
+  NUM_COUNTERS
+} instrumentCounter;
+
+// Times go in power-of-two buckets of microseconds: bucket 0 is under 1 us,
+// bucket b from 2^(b-1) us up to 2^b us, and the last everything longer.
+#define INSTRUMENT_BUCKETS 16
+
+typedef struct _probe_stats {
+  uint32_t count;
+  uint32_t total_us;
+  uint32_t max_us;
+  uint32_t buckets[INSTRUMENT_BUCKETS];
+} probeStats;
+
+// The phone asks for the stats with KEY_STATS_REQUEST, giving the index of
+// the record it wants, and each answer comes back in KEY_STATS, one record
+// to a message; it asks for the next until it has num_records. Record 0 is
+// an instrumentSummary, and record 1 + p is probe p's probeStats. All
+// little-endian, as on the watch.
+#define KEY_STATS_REQUEST 42
+#define KEY_STATS 43
+
+#define INSTRUMENT_VERSION 2
+
+typedef struct _instrument_header {
+  uint8_t version;
+  uint8_t index;
+  uint8_t num_records;
+  uint8_t reserved;
+} instrumentHeader;
+
+typedef struct _instrument_summary {
+  // Seconds since launch, when the counting started.
+  uint32_t uptime_s;
+  uint32_t counters[NUM_COUNTERS];
+  // How often each field's layer has been redrawn.
+  uint32_t redraws[NUM_FIELDS];
+} instrumentSummary;
+
+#ifdef INSTRUMENT
+
+// The clock the timers read. The watch's finest is time_ms(), so there the
+// times come in whole milliseconds; a build can supply a finer one by
+// defining INSTRUMENT_CLOCK_US to a function returning microseconds.
+uint32_t instrument_clock_us(void);
+
+// Start counting.
+void instrument_init(void);
+
+void instrument_record(instrumentProbe probe, uint32_t us);
+void instrument_count(instrumentCounter counter, uint32_t n);
+void instrument_count_redraw(int field);
+
+// Log everything with APP_LOG, or only if an hour has passed since the
+// last time it was logged on the hour.
+void instrument_log(void);
+void instrument_log_hourly(void);
+
+// Answer a KEY_STATS_REQUEST, and the outbox size that needs.
+void instrument_send(int32_t index);
+uint32_t instrument_outbox_size(void);
+
+// Time a block: INSTRUMENT_START(start) declares start, and
+// INSTRUMENT_STOP(probe, start) records the time since.
+#define INSTRUMENT_START(start) uint32_t start = instrument_clock_us()
+#define INSTRUMENT_STOP(probe, start) instrument_record(probe, instrument_clock_us() - (start))
+#define INSTRUMENT_VALUE(probe, us) instrument_record(probe, us)
+#define INSTRUMENT_COUNT(counter, n) instrument_count(counter, n)
+#define INSTRUMENT_REDRAW(field) instrument_count_redraw(field)
+
+#else
+
+#define instrument_init() ((void)0)
+#define instrument_log() ((void)0)
+#define instrument_log_hourly() ((void)0)
+#define instrument_send(index) ((void)(index))
+#define instrument_outbox_size() 0
+#define INSTRUMENT_START(start)
+#define INSTRUMENT_STOP(probe, start) ((void)0)
+#define INSTRUMENT_VALUE(probe, us) ((void)0)
+#define INSTRUMENT_COUNT(counter, n) ((void)0)
+#define INSTRUMENT_REDRAW(field) ((void)0)
+
+#endif
@@ -0,0 +1,137 @@
+#include "layout.h"
+#include "settings.h"
+
+// The foreground and background colours of each of the time panels is set for
+// a reason.
+// Local time is solar time, therefore yellow like the Sun.
+#define LOCAL_COLOUR { .argb = GColorPastelYellowARGB8 }
+// UTC is time at the Greenwich observatory, therefore green.
+#define UTC_COLOUR { .argb = GColorMintGreenARGB8 }
+// LST is sky time, therefore blue like the sky.
+#define LST_COLOUR { .argb = GColorPictonBlueARGB8 }
+// All times are in black for easy reading, and the labels are in reverse.
+#define BLACK { .argb = GColorBlackARGB8 }
+#define WHITE { .argb = GColorWhiteARGB8 }
+#define YELLOW { .argb = GColorYellowARGB8 }
+// The LST's seconds sit on top of the LST panel, so they leave its colour
+// showing through.
+#define CLEAR { .argb = GColorClearARGB8 }
+
+// To add a platform, add a block here with its screen size and elements.
+// The positions are constant expressions, so the compiler works them out,
+// truncating towards zero just as the old runtime assignments did.
+
+#if defined(PBL_PLATFORM_BASALT)
+// We're running on a Pebble Time.
+// The rectangular watches get three rectangular panels, and
+// their labels (L, U, S) go on the left in reverse text.
+#define SCREEN_W 144
+#define SCREEN_H 168
+
+// Define some heights.
+#define FULL_H (SCREEN_H / 3)
+#define SMALL_H (FULL_H / 4)
+#define MEDIUM_H (SCREEN_H - 2 * FULL_H - SMALL_H)
+// The labels all have the same width, and the times fill the rest.
+#define LABEL_W (SCREEN_W / 6)
+#define TIME_W (SCREEN_W - LABEL_W)
+// The starting y locations of the labels, which the times line up with.
+#define LOCAL_Y 0
+#define UTC_Y (LOCAL_Y + FULL_H + SMALL_H)
+#define LST_Y (SCREEN_H - MEDIUM_H)
+// The LST's seconds go in the bottom right corner of its panel, clear of
+// the hours and minutes.
+#define SECONDS_W 16
+
+const elementLayout face_layout[] = {
+  // The labels, all of which go to the left.
+  { FIELD_NONE, "L", BLACK, WHITE, FONT_KEY_BITHAM_30_BLACK, GTextAlignmentCenter,
+    { 0, LOCAL_Y, LABEL_W, FULL_H } },
+  { FIELD_NONE, "U", BLACK, WHITE, FONT_KEY_BITHAM_30_BLACK, GTextAlignmentCenter,
+    { 0, UTC_Y, LABEL_W, FULL_H } },
+  { FIELD_LST_LABEL, "S", BLACK, WHITE, FONT_KEY_BITHAM_30_BLACK, GTextAlignmentCenter,
+    { 0, LST_Y, LABEL_W, MEDIUM_H } },
+  // The times, which all appear on the right.
+  { FIELD_LOCAL_TIME, NULL, LOCAL_COLOUR, BLACK, FONT_KEY_BITHAM_42_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { LABEL_W, LOCAL_Y, TIME_W, FULL_H } },
+  // The local date appears just below the local time, and covers the
+  // entire width of the display.
+  { FIELD_LOCAL_DATE, NULL, WHITE, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, (int16_t)(LOCAL_Y + FULL_H - SMALL_H * 0.1), SCREEN_W, SMALL_H } },
+  { FIELD_UTC_TIME, NULL, UTC_COLOUR, BLACK, FONT_KEY_BITHAM_42_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { LABEL_W, (int16_t)(UTC_Y + SMALL_H * 0.5), TIME_W, FULL_H } },
+  { FIELD_LST_TIME, NULL, LST_COLOUR, BLACK, FONT_KEY_BITHAM_34_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { LABEL_W, LST_Y, TIME_W, MEDIUM_H } },
+  { FIELD_LST_SECONDS, NULL, CLEAR, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentRight,
+    { SCREEN_W - SECONDS_W, SCREEN_H - SMALL_H - 4, SECONDS_W, SMALL_H } },
+  // The MJD is just above the UTC, aligned to the right.
+  { FIELD_MJD, NULL, UTC_COLOUR, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentRight,
+    { LABEL_W, LOCAL_Y + FULL_H + SMALL_H, TIME_W, SMALL_H } },
+  // The DST indicator is under the "L" label (because DST is local).
+  // It has label colouring, except yellow text.
+  { FIELD_LOCAL_DST, NULL, BLACK, YELLOW, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, (int16_t)(FULL_H - SMALL_H * 1.2), LABEL_W, SMALL_H } }
+};
+
+// There's only room for one big letter in the label.
+const int lst_label_chars = 1;
+const char *const lst_compact_font_key = FONT_KEY_GOTHIC_14_BOLD;
+
+#elif defined(PBL_PLATFORM_CHALK)
+// We're running on a Pebble Time Round.
+// Round watches have a slightly different layout, but the
+// same three panels, mixed together somewhat more. All elements
+// take up the entire width of the face, and are centered.
+#define SCREEN_W 180
+#define SCREEN_H 180
+
+// Define some heights.
+#define FULL_H (SCREEN_H / 3)
+#define SMALL_H (FULL_H / 4)
+// At the top is the UTC label, and below that the time and MJD. Then the
+// local date, label and time (this is where the watch is widest), and
+// finally the LST time and label.
+#define UTC_TIME_Y (int16_t)(SMALL_H * 0.5)
+#define DATE_Y (int16_t)(FULL_H + SMALL_H * 1.2)
+#define LOCAL_TIME_H (FULL_H - SMALL_H)
+#define LOCAL_TIME_Y (int16_t)(DATE_Y + SMALL_H * 0.5)
+#define DST_X (int16_t)(SCREEN_W * 0.84)
+#define LST_TIME_Y (int16_t)(LOCAL_TIME_Y + LOCAL_TIME_H * 0.9)
+// The LST's seconds go just right of its hours and minutes.
+#define SECONDS_X (int16_t)(SCREEN_W * 0.75)
+#define SECONDS_W 18
+
+const elementLayout face_layout[] = {
+  { FIELD_UTC_TIME, NULL, UTC_COLOUR, BLACK, FONT_KEY_BITHAM_42_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { 0, UTC_TIME_Y, SCREEN_W, FULL_H } },
+  { FIELD_NONE, "UTC", BLACK, WHITE, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, 0, SCREEN_W, SMALL_H } },
+  { FIELD_LST_TIME, NULL, LST_COLOUR, BLACK, FONT_KEY_BITHAM_34_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { 0, LST_TIME_Y, SCREEN_W, SCREEN_H - LST_TIME_Y } },
+  { FIELD_LST_SECONDS, NULL, CLEAR, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentLeft,
+    { SECONDS_X, LST_TIME_Y + SMALL_H, SECONDS_W, SMALL_H } },
+  { FIELD_LOCAL_TIME, NULL, LOCAL_COLOUR, BLACK, FONT_KEY_BITHAM_42_MEDIUM_NUMBERS,
+    GTextAlignmentCenter, { 0, LOCAL_TIME_Y, SCREEN_W, LOCAL_TIME_H } },
+  // The DST indicator is to the right of the local time (because DST is
+  // local), with the same colours as the local time.
+  { FIELD_LOCAL_DST, NULL, LOCAL_COLOUR, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentLeft,
+    { DST_X, (int16_t)(LOCAL_TIME_Y + 1.5 * SMALL_H), SCREEN_W - DST_X, SMALL_H } },
+  { FIELD_MJD, NULL, UTC_COLOUR, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, (int16_t)(FULL_H - SMALL_H * 0.65), SCREEN_W, SMALL_H } },
+  { FIELD_LOCAL_DATE, NULL, WHITE, BLACK, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, DATE_Y, SCREEN_W, SMALL_H } },
+  { FIELD_NONE, "LOCAL", BLACK, WHITE, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, (int16_t)(FULL_H + SMALL_H * 0.35), SCREEN_W, SMALL_H } },
+  { FIELD_LST_LABEL, "LST", BLACK, WHITE, FONT_KEY_GOTHIC_14_BOLD, GTextAlignmentCenter,
+    { 0, SCREEN_H - SMALL_H, SCREEN_W, SMALL_H } }
+};
+
+// The label runs right across the bottom, so it can take a whole name.
+const int lst_label_chars = SITE_NAME_LENGTH - 1;
+const char *const lst_compact_font_key = FONT_KEY_GOTHIC_14_BOLD;
+
+#else
+#error "There is no face layout for this platform."
+#endif
+
+const int face_layout_count = sizeof(face_layout) / sizeof(face_layout[0]);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <pebble.h>
+
+// The fields on the face that change as time goes by.
+typedef enum {
+  FIELD_NONE = -1,
+  FIELD_LOCAL_TIME,
+  FIELD_LOCAL_DATE,
+  FIELD_LOCAL_DST,
+  FIELD_UTC_TIME,
+  FIELD_MJD,
+  FIELD_LST_TIME,
+  FIELD_LST_LABEL,
+  // The LST's seconds, shown in a corner of the LST panel in seconds mode.
+  FIELD_LST_SECONDS,
+  NUM_FIELDS
+} displayFieldId;
+
+// The most elements any platform's layout has.
+#define MAX_ELEMENTS 10
+
+// Structure containing all the required values for a particular element.
+typedef struct _element_position {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+} elementPosition;
+
+typedef struct _element_layout {
+  // The field this element shows, or FIELD_NONE if it's a fixed label.
+  displayFieldId field;
+  // The fixed text, or for a field, what it shows by default.
+  const char *label;
+  GColor background_colour;
+  GColor foreground_colour;
+  const char *font_key;
+  GTextAlignment text_alignment;
+  elementPosition element_position;
+} elementLayout;
+
+// The elements of the face for the platform we're built for, in the order
+// they are drawn. These are fixed at build time, so loading the window needs
+// no layout work and no allocation beyond the layers themselves.
+extern const elementLayout face_layout[];
+extern const int face_layout_count;
+
+// When there is more than one site, the LST label shows the first few
+// characters of the site's name, and the LST panel can instead list every
+// site in a smaller font.
+extern const int lst_label_chars;
+extern const char *const lst_compact_font_key;
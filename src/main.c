@@ -1,516 +1,810 @@
 #include <pebble.h>
-
-#define KEY_LONGITUDE 0
+#include "settings.h"
+#include "format.h"
+#include "layout.h"
+#include "catalogue.h"
+#include "config.h"
+#include "sidereal.h"
+#include "snapshot.h"
+#include "instrument.h"
+
+// Define RENDER_CANVAS to draw the whole face from a single Layer, rather than
+// from one heap-allocated TextLayer per element.
+// #define RENDER_CANVAS
 
 static Window *s_my_window;
-static TextLayer *s_local_time, *s_local_label, *s_local_dst, *s_local_date;
-static TextLayer *s_utc_label, *s_utc_time, *s_mjd;
-static TextLayer *s_lst_label, *s_lst_time;
-
-int num_text_layers = 0;
-TextLayer **all_text_layers = NULL;
-
-// Structure containing all the required values for a particular element.
-typedef struct _element_position {
-  int16_t x;
-  int16_t y;
-  int16_t w;
-  int16_t h;
-} elementPosition;
-
-typedef struct _element_properties {
-  Layer *window_layer;
-  TextLayer **text_layer;
-  GColor background_colour;
-  GColor foreground_colour;
-  GFont text_font;
-  GTextAlignment text_alignment;
-  elementPosition element_position;
-} elementProperties;
-
-// An all-in-one section maker.
-static void add_window_element(elementProperties *element_properties) {
-  *(element_properties->text_layer) = text_layer_create(GRect(element_properties->element_position.x, 
-                                                      element_properties->element_position.y, 
-                                                      element_properties->element_position.w, 
-                                                      element_properties->element_position.h));
-  text_layer_set_background_color(*(element_properties->text_layer), element_properties->background_colour);
-  text_layer_set_text_color(*(element_properties->text_layer), element_properties->foreground_colour);
-  text_layer_set_font(*(element_properties->text_layer), element_properties->text_font);
-  text_layer_set_text_alignment(*(element_properties->text_layer), element_properties->text_alignment);
-  layer_add_child(element_properties->window_layer, text_layer_get_layer(*(element_properties->text_layer)));
-
-  // We keep track of all our text layers so we can destroy them when we get unloaded.
-  num_text_layers++;
-  all_text_layers = realloc(all_text_layers, num_text_layers * sizeof(TextLayer *));
-  all_text_layers[num_text_layers - 1] = *(element_properties->text_layer);
-}
-
-// Calculate the fraction of the day past midnight.
-static double calc_day_fraction(struct tm *t) {
-  double dayfrac = 0.0;
-  dayfrac += (double)t->tm_hour + (double)t->tm_min / 60.0 + (double)t->tm_sec / 3600.0;
-  dayfrac /= 24.0;
-  return(dayfrac);
-}
-
-// Calculate the Modified Julian Date (MJD).
-static double calc_mjd(struct tm *t) {
-  double day_fraction = calc_day_fraction(t);
-  double mjd;
-  int m, y, c, yy, x1, x2, x3;
-
-  if (t->tm_mon < 2) {
-    m = t->tm_mon + 10;
-    y = t->tm_year + 1900 - 1;
-  } else {
-    m = t->tm_mon - 2;
-    y = t->tm_year + 1900;
+
+// GMST at the start of the current UTC day, which each update steps on from.
+static siderealAnchor s_gmst_anchor;
+
+// Each site's LST is GMST plus a fixed offset, its longitude in turns. We
+// keep those offsets ready, so that however many sites there are, GMST is
+// still worked out only once per update.
+static turns_t s_site_offsets[MAX_SITES];
+
+// Convert the configured longitudes from degrees to turns, and hand dUT1 to
+// the engine (which ignores it unless built with SIDEREAL_ERA_DUT1).
+static void update_sidereal_settings() {
+  const Settings *settings = settings_get();
+  int i;
+  for (i = 0; i < MAX_SITES; i++) {
+    s_site_offsets[i] = sidereal_longitude(settings->sites[i].longitude_e7);
   }
+  sidereal_set_dut1(settings->dut1_ms);
+}
 
-  yy = y % 100;
-  c = (y - yy) / 100;
-  x1 = (int)(146097.0 * (double)c / 4.0);
-  x2 = (int)(1461.0 * (double)yy / 4.0);
-  x3 = (int)((153.0 * (double)m + 2.0) / 5.0);
-  
-  mjd = (double)x1 + (double)x2 + (double)x3 + (double)t->tm_mday - 678882.0 + day_fraction;
-  return(mjd);
+// Calculate the sidereal time (LST) at a site.
+static turns_t gmst2lst(turns_t gmst, int site) {
+  return(gmst + s_site_offsets[site]);
 }
 
-// Calculate the sidereal time (GMST).
-static double mjd2gmst(double mjd) {
-  // The Julian date at the start of the epoch.
-  double jdJ2000 = 2451545.0;
-  
-  // The number of days in a century.
-  double jdCentury = 36525.0;
-  
-  double dUT1 = 0.0;
+// Rather than waking every second and hoping to catch each change, we wake
+// exactly when a displayed clock rolls over, from a single timer re-armed
+// after each update for whichever comes first. The solar clocks (local, UTC,
+// and the date and MJD at midnight) all roll over on the minute. LST minutes
+// are about 0.16 s shorter and drift against those, so most minutes have
+// one of each. While the LST shows seconds, it rolls over each sidereal
+// second instead.
+static AppTimer *s_rollover_timer = NULL;
+static int64_t s_rollover_target_ms;
+
+// Seconds mode: when it's configured, a flick of the wrist has the LST panel
+// show the sidereal seconds too, for seconds_timeout_s (see tap_handler).
+// Each second only the seconds change, so rather than work everything out
+// again, we step on from the LST last shown by the sidereal rate, and only
+// the seconds are redrawn.
+typedef struct _seconds_mode {
+  bool active;
+  int64_t until_ms;
+  // The LST of the site shown, and when it was worked out.
+  int64_t at_ms;
+  turns_t lst;
+} secondsMode;
+
+static secondsMode s_seconds;
+
+static void rollover_timer_handler(void *data);
+
+// Arm the timer for the next time a clock rolls over: the next solar
+// minute, or the LST, which is lst at now_ms, rolling over to a new unit (a
+// sidereal minute or second), whichever is sooner.
+static void schedule_rollover(int64_t now_ms, turns_t lst, turns_t unit) {
+  turns_t remaining = unit - (lst % unit);
+  // Round up, so that we always wake just after the rollover, not before.
+  uint32_t wait_ms = (uint32_t)(remaining / SIDEREAL_RATE_MS) + 1;
+  uint32_t minute_wait_ms = 60000 - (uint32_t)(now_ms % 60000);
+  if (minute_wait_ms < wait_ms) {
+    wait_ms = minute_wait_ms;
+  }
+  s_rollover_target_ms = now_ms + wait_ms;
+  if (!s_rollover_timer || !app_timer_reschedule(s_rollover_timer, wait_ms)) {
+    s_rollover_timer = app_timer_register(wait_ms, rollover_timer_handler, NULL);
+  }
+}
 
-  double a = 101.0 + 24110.54841 / 86400.0;
-  double b = 8640184.812866 / 86400.0;
-  double e = 0.093104 / 86400.0;
-  double d = 0.0000062 / 86400.0;
-  
-  double tu = ((double)((int)mjd) - (jdJ2000 - 2400000.5)) / jdCentury;
-  double sidTim = a + tu * (b + tu * (e - tu * d));
-  sidTim -= (double)((int)sidTim);
-  if (sidTim < 0) {
-    sidTim += 1;
+// Each displayed field remembers the text it last rendered, so that we only
+// touch its layer (which marks it dirty and forces a redraw) when the text
+// actually changes. The field's buffer is the one the layer displays.
+// A field can also be shown compact, in a smaller font, such as the LST
+// panel when it lists every site.
+#define FIELD_TEXT_LENGTH 48
+
+typedef struct _display_field {
+  TextLayer *text_layer;
+  const char *font_key;
+  char text[FIELD_TEXT_LENGTH];
+  bool dirty;
+  bool compact;
+  bool font_dirty;
+} displayField;
+
+static displayField s_fields[NUM_FIELDS];
+
+// Change the text of a field, marking it dirty only if it differs.
+static void set_field_text(displayFieldId id, const char *text) {
+  displayField *field = &s_fields[id];
+  if (strncmp(field->text, text, sizeof(field->text)) != 0) {
+    size_t n = strlen(text);
+    if (n >= sizeof(field->text)) {
+      n = sizeof(field->text) - 1;
+    }
+    memcpy(field->text, text, n);
+    field->text[n] = '\0';
+    field->dirty = true;
   }
-  
-  double gmst = sidTim + (mjd - (double)((int)mjd) + dUT1 / 86400.0) * 1.002737909350795;
-  while (gmst < 0) {
-    gmst += 1;
+}
+
+// Show a field compact or not, changing its font only if needed.
+static void set_field_compact(displayFieldId id, bool compact) {
+  displayField *field = &s_fields[id];
+  if (field->compact != compact) {
+    field->compact = compact;
+    field->font_dirty = true;
+    field->dirty = true;
+  }
+}
+
+// The text shown by an element of the layout.
+static const char *element_text(const elementLayout *element) {
+  if (element->field == FIELD_NONE) {
+    return(element->label);
   }
-  while (gmst > 1) {
-    gmst -= 1;
+  return(s_fields[element->field].text);
+}
+
+#ifdef RENDER_CANVAS
+// In canvas mode the whole face is one Layer, drawn straight from the layout.
+static Layer *s_canvas_layer = NULL;
+static GFont s_element_fonts[MAX_ELEMENTS];
+static GFont s_compact_font;
+
+// The window has no background of its own, so the framebuffer keeps the
+// last frame, and when only the LST's seconds have changed we draw just
+// them over it. Anything else, or the window coming back into view after
+// something else covered it, means drawing the whole face.
+static bool s_canvas_full_redraw = true;
+static int s_seconds_element = -1;
+static GColor s_seconds_backdrop;
+
+static GRect element_rect(const elementLayout *element) {
+  return(GRect(element->element_position.x, element->element_position.y,
+               element->element_position.w, element->element_position.h));
+}
+
+static void canvas_update_proc(Layer *layer, GContext *ctx) {
+  int i;
+  INSTRUMENT_START(start);
+  if (!s_canvas_full_redraw && (s_seconds_element >= 0)) {
+    const elementLayout *element = &face_layout[s_seconds_element];
+    graphics_context_set_fill_color(ctx, s_seconds_backdrop);
+    graphics_fill_rect(ctx, element_rect(element), 0, GCornerNone);
+    graphics_context_set_text_color(ctx, element->foreground_colour);
+    graphics_draw_text(ctx, element_text(element), s_element_fonts[s_seconds_element],
+                       element_rect(element), GTextOverflowModeWordWrap,
+                       element->text_alignment, NULL);
+    INSTRUMENT_STOP(PROBE_DRAW, start);
+    return;
   }
-  
-  return(gmst);
+  s_canvas_full_redraw = false;
+  // Stand in for the window's background.
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+  for (i = 0; i < face_layout_count; i++) {
+    const elementLayout *element = &face_layout[i];
+    GRect rect = element_rect(element);
+    bool compact = (element->field != FIELD_NONE) && s_fields[element->field].compact;
+    // Draw it just as a TextLayer would.
+    graphics_context_set_fill_color(ctx, element->background_colour);
+    graphics_fill_rect(ctx, rect, 0, GCornerNone);
+    graphics_context_set_text_color(ctx, element->foreground_colour);
+    graphics_draw_text(ctx, element_text(element),
+                       compact ? s_compact_font : s_element_fonts[i], rect,
+                       GTextOverflowModeWordWrap, element->text_alignment, NULL);
+  }
+  INSTRUMENT_STOP(PROBE_DRAW, start);
 }
+#else
+// Otherwise each element gets its own TextLayer.
+static TextLayer *s_text_layers[MAX_ELEMENTS];
+#endif
 
-// Calculate the sidereal time (LST).
-static double gmst2lst(double gmst) {
-  // Get the longitude from our configuration.
-  double longitude;
-  if (persist_exists(KEY_LONGITUDE)) { 
-    persist_read_data(KEY_LONGITUDE, &longitude, sizeof(double));
+// Push the dirty fields out to their layers.
+static void flush_fields() {
+  int i;
+  INSTRUMENT_START(start);
+#ifdef RENDER_CANVAS
+  bool any_dirty = false;
+  if (!s_canvas_layer) {
+    return;
+  }
+  for (i = 0; i < NUM_FIELDS; i++) {
+    if (s_fields[i].dirty) {
+      s_fields[i].dirty = false;
+      s_fields[i].font_dirty = false;
+      INSTRUMENT_REDRAW(i);
+      any_dirty = true;
+      if (i != FIELD_LST_SECONDS) {
+        s_canvas_full_redraw = true;
+      }
+    }
+  }
+  // The canvas redraws everything at once, unless it's just the seconds.
+  if (any_dirty) {
+    layer_mark_dirty(s_canvas_layer);
+  }
+#else
+  for (i = 0; i < NUM_FIELDS; i++) {
+    if (s_fields[i].font_dirty && s_fields[i].text_layer) {
+      text_layer_set_font(s_fields[i].text_layer,
+                          fonts_get_system_font(s_fields[i].compact ? lst_compact_font_key :
+                                                s_fields[i].font_key));
+      s_fields[i].font_dirty = false;
+    }
+    if (s_fields[i].dirty && s_fields[i].text_layer) {
+      text_layer_set_text(s_fields[i].text_layer, s_fields[i].text);
+      s_fields[i].dirty = false;
+      INSTRUMENT_REDRAW(i);
+    }
+  }
+#endif
+  INSTRUMENT_STOP(PROBE_FLUSH, start);
+}
+
+// Make sure every field is drawn, such as when its layer is new.
+static void invalidate_fields() {
+  int i;
+  for (i = 0; i < NUM_FIELDS; i++) {
+    s_fields[i].dirty = true;
+    s_fields[i].font_dirty = s_fields[i].compact;
+  }
+#ifdef RENDER_CANVAS
+  s_canvas_full_redraw = true;
+#endif
+}
+
+// What the LST panel shows, which a tap moves on to the next: each site in
+// turn, then (when there's more than one) all the sites at once, then (when
+// there's a catalogue) the sources for the last site shown on its own.
+typedef enum {
+  PANEL_SITE,
+  PANEL_ALL_SITES,
+  PANEL_SOURCES
+} lstPanelKind;
+
+static int s_lst_panel = 0;
+static int s_source_site = 0;
+
+// The LST label from the layout, which we show unless it's naming a site.
+static const char *s_lst_label = "";
+
+// How much of each name the compact list of sites shows, and how many
+// sources fit in the panel.
+#define COMPACT_NAME_CHARS 4
+#define TOP_SOURCES 2
+
+static int lst_panel_count() {
+  int num_sites = settings_get()->num_sites;
+  return(num_sites + ((num_sites > 1) ? 1 : 0) + ((catalogue_count() > 0) ? 1 : 0));
+}
+
+static lstPanelKind lst_panel_kind(int panel) {
+  int num_sites = settings_get()->num_sites;
+  if (panel < num_sites) {
+    return(PANEL_SITE);
+  }
+  if ((panel == num_sites) && (num_sites > 1)) {
+    return(PANEL_ALL_SITES);
+  }
+  return(PANEL_SOURCES);
+}
+
+// Copy up to n characters of a site's name, or its number if it has none.
+static char *copy_site_name(char *buffer, int site, int n) {
+  const char *name = settings_get()->sites[site].name;
+  if (name[0] == '\0') {
+    *buffer++ = (char)('1' + site);
+  }
+  while ((n-- > 0) && (*name != '\0')) {
+    *buffer++ = *name++;
+  }
+  *buffer = '\0';
+  return(buffer);
+}
+
+// Write the most pressing sources for a site, one to a line:
+// "PKS1934 -1:23 s2:15" has an hour angle of -1:23 and sets in 2:15.
+static char *format_sources(char *buffer, int site, turns_t lst) {
+  sourceStatus top[TOP_SOURCES];
+  int num_top = catalogue_update(site, settings_get()->latitudes_e7[site],
+                                 (uint32_t)(lst >> 32), top, TOP_SOURCES);
+  char *p = buffer;
+  int i;
+  if (num_top == 0) {
+    strcpy(buffer, "No sources up");
+    return(buffer + strlen(buffer));
+  }
+  for (i = 0; i < num_top; i++) {
+    size_t n = strlen(top[i].source->name);
+    if (i > 0) {
+      *p++ = '\n';
+    }
+    memcpy(p, top[i].source->name, n);
+    p += n;
+    *p++ = ' ';
+    if (top[i].hour_angle >= 0) {
+      *p++ = '+';
+    }
+    // Hour angle is sidereal time, so it goes in sidereal minutes.
+    p = format_hmm(p, (int)(((int64_t)top[i].hour_angle * 1440) >> 32));
+    if (top[i].state == SOURCE_ALWAYS_UP) {
+      strcpy(p, " up");
+      p += 3;
+    } else {
+      *p++ = ' ';
+      *p++ = (top[i].state == SOURCE_UP) ? 's' : 'r';
+      p = format_hmm(p, top[i].minutes);
+    }
+  }
+  return(p);
+}
+
+// Whether the LST panel is showing seconds: only a single site's LST has
+// room for them.
+static bool seconds_showing() {
+  return(s_seconds.active && (lst_panel_kind(s_lst_panel) == PANEL_SITE));
+}
+
+// Show the seconds of the LST, or nothing if they aren't showing.
+static void set_seconds_field(turns_t lst) {
+  char buffer[4] = "";
+  if (seconds_showing()) {
+    format_ss(buffer, (int)(sidereal_seconds(lst) % 60));
+  }
+  set_field_text(FIELD_LST_SECONDS, buffer);
+}
+
+// Show the LST on the panel, and return the LST that will next roll over to
+// a new minute.
+static turns_t update_lst_fields(turns_t gmst) {
+  const Settings *settings = settings_get();
+  char lst_buffer[FIELD_TEXT_LENGTH], label_buffer[SITE_NAME_LENGTH + 1];
+  char *p = lst_buffer;
+  lstPanelKind kind = lst_panel_kind(s_lst_panel);
+  int first = s_lst_panel, last = s_lst_panel, i;
+  turns_t next = 0;
+  if (kind == PANEL_SITE) {
+    s_source_site = s_lst_panel;
+  } else if (kind == PANEL_ALL_SITES) {
+    first = 0;
+    last = settings->num_sites - 1;
   } else {
-    longitude = 0.0; // 149.5501388 / 360.0; // ATCA longitude in turns.
+    first = last = s_source_site;
+  }
+  for (i = first; i <= last; i++) {
+    turns_t lst = gmst2lst(gmst, i);
+    // The first to roll over is the one furthest into its minute.
+    if ((i == first) || ((lst % SIDEREAL_MINUTE) > (next % SIDEREAL_MINUTE))) {
+      next = lst;
+    }
+    if (kind == PANEL_SOURCES) {
+      p = format_sources(p, i, lst);
+    } else if (kind == PANEL_ALL_SITES) {
+      // Two sites to a line: "ATCA 12:34  PKS 11:58".
+      if (i > first) {
+        *p++ = ((i - first) % 2) ? ' ' : '\n';
+        if ((i - first) % 2) {
+          *p++ = ' ';
+        }
+      }
+      p = copy_site_name(p, i, COMPACT_NAME_CHARS);
+      *p++ = ' ';
+      p = format_hhmm(p, sidereal_minutes(lst));
+    } else {
+      p = format_hhmm(p, sidereal_minutes(lst));
+    }
+  }
+  set_field_compact(FIELD_LST_TIME, kind != PANEL_SITE);
+  set_field_text(FIELD_LST_TIME, lst_buffer);
+
+  // Say which site it is, if there's a choice.
+  if ((kind == PANEL_ALL_SITES) || (settings->num_sites == 1)) {
+    set_field_text(FIELD_LST_LABEL, s_lst_label);
+  } else {
+    copy_site_name(label_buffer, first, lst_label_chars);
+    set_field_text(FIELD_LST_LABEL, label_buffer);
+  }
+  // With a single site, next is its LST.
+  set_seconds_field(next);
+  return(next);
+}
+
+// On a warm start the first frame comes from the snapshot, with its
+// settings, and the settings and catalogue are only read from flash after
+// that, before anything else needs them.
+static bool s_launch_pending = false;
+
+static void complete_launch() {
+  if (!s_launch_pending) {
+    return;
   }
-  longitude /= 360.0; // Convert degrees to turns.
-  double lst = gmst + longitude;
-  while (lst > 1) {
-    lst -= 1;
+  s_launch_pending = false;
+  settings_load();
+  update_sidereal_settings();
+  catalogue_load();
+  if (s_lst_panel >= lst_panel_count()) {
+    s_lst_panel = 0;
   }
-  while (lst < 0) {
-    lst += 1;
+  if (s_source_site >= settings_get()->num_sites) {
+    s_source_site = 0;
   }
-  return(lst * 24.0);
 }
 
 // Update the time segments.
 static void update_time() {
   // Get a tm structure.
-  time_t temp = time(NULL); 
+  time_t temp;
+  uint16_t temp_ms = time_ms(&temp, NULL);
+  // UTC comes straight from the epoch seconds, so only local time needs
+  // a conversion.
   struct tm *tick_time = localtime(&temp);
-  struct tm *utc_tick_time = gmtime(&temp);
 
   // Write the current hours and minutes into a buffer for each of the time types
   // we need to display.
-  static char s_local_time_buffer[8], s_local_date_buffer[23], s_local_is_dst[4];
-  static char s_utc_time_buffer[8], s_mjd_buffer[12], s_lst_time_buffer[8];
-  double mjd_time = calc_mjd(utc_tick_time);
-  double gmst_time = mjd2gmst(mjd_time);
-  double lst_time = gmst2lst(gmst_time);
-  int lst_hour = (int)lst_time;
-  int lst_min = (int)((lst_time - (double)lst_hour) * 60);
-  strftime(s_local_time_buffer, sizeof(s_local_time_buffer), "%H:%M", tick_time);
-  strftime(s_local_date_buffer, sizeof(s_local_date_buffer), "%a %Y-%m-%d DOY %j", tick_time);
-  snprintf(s_mjd_buffer, 12, "MJD %d  ", (int)mjd_time);
-  snprintf(s_lst_time_buffer, 6, "%02d:%02d", lst_hour, lst_min);
-  strftime(s_utc_time_buffer, sizeof(s_utc_time_buffer), "%H:%M", utc_tick_time);
-  if (tick_time->tm_isdst) {
-    snprintf(s_local_is_dst, 3, "DST");
-  } else {
-    snprintf(s_local_is_dst, 3, "   ");
+  static char s_local_time_buffer[8], s_local_date_buffer[23];
+  static char s_utc_time_buffer[8], s_mjd_buffer[FORMAT_MJD_LENGTH];
+  int32_t mjd_time, utc_seconds;
+  turns_t gmst_time;
+  int64_t now_ms = (int64_t)temp * 1000 + temp_ms;
+  INSTRUMENT_START(start);
+  complete_launch();
+  INSTRUMENT_START(gmst_start);
+  gmst_time = sidereal_time2gmst(&s_gmst_anchor, temp, temp_ms, &mjd_time, &utc_seconds);
+  INSTRUMENT_STOP(PROBE_GMST, gmst_start);
+  // The seconds go once it's been long enough since the last flick.
+  if (s_seconds.active && (now_ms >= s_seconds.until_ms)) {
+    s_seconds.active = false;
   }
+  INSTRUMENT_START(format_start);
+  format_hhmm(s_local_time_buffer, tick_time->tm_hour * 60 + tick_time->tm_min);
+  format_date(s_local_date_buffer, tick_time);
+  format_mjd(s_mjd_buffer, mjd_time);
+  format_hhmm(s_utc_time_buffer, utc_seconds / 60);
   
-  // Display the times in the appropriate segments.
-  text_layer_set_text(s_utc_time, s_utc_time_buffer);
-  text_layer_set_text(s_local_time, s_local_time_buffer);
-  text_layer_set_text(s_local_date, s_local_date_buffer);
-  text_layer_set_text(s_mjd, s_mjd_buffer);
-  text_layer_set_text(s_lst_time, s_lst_time_buffer);
-  text_layer_set_text(s_local_dst, s_local_is_dst);
+  // Display the times in the appropriate segments, if they've changed.
+  set_field_text(FIELD_UTC_TIME, s_utc_time_buffer);
+  set_field_text(FIELD_LOCAL_TIME, s_local_time_buffer);
+  set_field_text(FIELD_LOCAL_DATE, s_local_date_buffer);
+  set_field_text(FIELD_MJD, s_mjd_buffer);
+  INSTRUMENT_STOP(PROBE_FORMAT, format_start);
+  INSTRUMENT_START(lst_start);
+  turns_t lst_time = update_lst_fields(gmst_time);
+  INSTRUMENT_STOP(PROBE_LST_PANEL, lst_start);
+  // (The DST flag has always been cut to two characters.)
+  set_field_text(FIELD_LOCAL_DST, tick_time->tm_isdst ? "DS" : "  ");
+  flush_fields();
+
+  // Sleep until a clock next changes, and keep the LST to step on from.
+  s_seconds.at_ms = now_ms;
+  s_seconds.lst = lst_time;
+  schedule_rollover(now_ms, lst_time, seconds_showing() ? SIDEREAL_SECOND : SIDEREAL_MINUTE);
+  INSTRUMENT_STOP(PROBE_UPDATE_TIME, start);
 }
 
-static void add_element_to_draw(elementProperties ***eorder, int *nprops,
-                                elementProperties *element) {
-  *eorder = (elementProperties **)realloc(*eorder, (*nprops + 1) * sizeof(elementProperties *));
-  (*eorder)[*nprops] = element;
-  (*nprops)++;
+// Show the LST's seconds at now_ms, when it's lst, touching nothing else on
+// the face.
+static void update_seconds(int64_t now_ms, turns_t lst) {
+  s_seconds.at_ms = now_ms;
+  s_seconds.lst = lst;
+  set_seconds_field(lst);
+  flush_fields();
+  schedule_rollover(now_ms, lst, SIDEREAL_SECOND);
 }
 
 static void main_window_load(Window *window) {
   int i;
   // Get information about the Window.
   Layer *window_layer = window_get_root_layer(window);
-  GRect bounds = layer_get_bounds(window_layer);
-
-  // All the elements we want to make.
-  elementProperties ep_local_time, ep_utc_time, ep_lst_time;
-  elementProperties ep_local_label, ep_utc_label, ep_lst_label;
-  elementProperties ep_date, ep_mjd, ep_dst;
-  // The order that we will draw the elements.
-  elementProperties **elementOrder = NULL;
-  int nelements = 0;
-  
-  // Set the dimensions for each of the face segments.
-  
-  // First, the properties that won't change between rectangular and round faces.
-  // Associate the correct label pointers.
-  ep_local_label.text_layer = &s_local_label;
-  ep_utc_label.text_layer = &s_utc_label;
-  ep_lst_label.text_layer = &s_lst_label;
-  ep_local_time.text_layer = &s_local_time;
-  ep_utc_time.text_layer = &s_utc_time;
-  ep_lst_time.text_layer = &s_lst_time;
-  ep_date.text_layer = &s_local_date;
-  ep_mjd.text_layer = &s_mjd;
-  ep_dst.text_layer = &s_local_dst;
-  // The foreground and background colours of each of the time panels is set for
-  // a reason.
-  // Local time is solar time, therefore yellow like the Sun.
-  ep_local_time.background_colour = GColorPastelYellow;
-  // UTC is time at the Greenwich observatory, therefore green.
-  ep_utc_time.background_colour = GColorMintGreen;
-  // LST is sky time, therefore blue like the sky.
-  ep_lst_time.background_colour = GColorPictonBlue;
-  // All times are in black for easy reading.
-  ep_local_time.foreground_colour = GColorBlack;
-  ep_utc_time.foreground_colour = GColorBlack;
-  ep_lst_time.foreground_colour = GColorBlack;
-  // And the times are always centered.
-  ep_local_time.text_alignment = GTextAlignmentCenter;
-  ep_utc_time.text_alignment = GTextAlignmentCenter;
-  ep_lst_time.text_alignment = GTextAlignmentCenter;
-  // The date looks the same in both faces too.
-  ep_date.background_colour = GColorWhite;
-  ep_date.foreground_colour = GColorBlack;
-  ep_date.text_alignment = GTextAlignmentCenter;
-  // The MJD is associated with UTC, so it gets the same colours.
-  ep_mjd.background_colour = ep_utc_time.background_colour;
-  ep_mjd.foreground_colour = ep_utc_time.foreground_colour;
-
-  // Define some heights.
-  int16_t full_height = bounds.size.h / 3;
-  int16_t small_height = full_height / 4;
-  
-#ifdef PBL_PLATFORM_BASALT
-  int16_t medium_height = bounds.size.h - 2 * full_height - small_height;
-  // We're running on a Pebble Time.
-  // The rectangular watches get three rectangular panels, and
-  // their labels (L, U, S) go on the left in reverse text.
-  
-  // Begin with each of the labels, all of which go to the left.
-  ep_local_label.element_position.x = 0;
-  ep_utc_label.element_position.x = 0;
-  ep_lst_label.element_position.x = 0;
-  // Each have the same width.
-  int16_t label_width = bounds.size.w / 6;
-  ep_local_label.element_position.w = label_width;
-  ep_utc_label.element_position.w = label_width;
-  ep_lst_label.element_position.w = label_width;
-  // Set their heights.
-  ep_local_label.element_position.h = full_height;
-  ep_utc_label.element_position.h = full_height;
-  ep_lst_label.element_position.h = medium_height;
-  // Calculate their starting y locations.
-  ep_local_label.element_position.y = 0;
-  ep_utc_label.element_position.y = ep_local_label.element_position.y + full_height +
-    small_height;
-  ep_lst_label.element_position.y = bounds.size.h - ep_lst_label.element_position.h;
-  // Each label has the same foreground and background colour.
-  ep_local_label.background_colour = GColorBlack;
-  ep_utc_label.background_colour = GColorBlack;
-  ep_lst_label.background_colour = GColorBlack;
-  ep_local_label.foreground_colour = GColorWhite;
-  ep_utc_label.foreground_colour = GColorWhite;
-  ep_lst_label.foreground_colour = GColorWhite;
-  // And each uses the same font and alignment.
-  ep_local_label.text_font = fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK);
-  ep_utc_label.text_font = fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK);
-  ep_lst_label.text_font = fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK);
-  ep_local_label.text_alignment = GTextAlignmentCenter;
-  ep_utc_label.text_alignment = GTextAlignmentCenter;
-  ep_lst_label.text_alignment = GTextAlignmentCenter;
-    
-  // Add the labels to the draw order.
-  add_element_to_draw(&elementOrder, &nelements, &ep_local_label);
-  add_element_to_draw(&elementOrder, &nelements, &ep_utc_label);
-  add_element_to_draw(&elementOrder, &nelements, &ep_lst_label);
-
-  // Now, do the time elements, which all appear on the right.
-  ep_local_time.element_position.x = label_width;
-  ep_utc_time.element_position.x = label_width;
-  ep_lst_time.element_position.x = label_width;
-  // They all have the same width.
-  int16_t time_width = bounds.size.w - label_width;
-  ep_local_time.element_position.w = time_width;
-  ep_utc_time.element_position.w = time_width;
-  ep_lst_time.element_position.w = time_width;
-  // They all start at the same height and have the same height as their
-  // associated labels.
-  ep_local_time.element_position.y = ep_local_label.element_position.y;
-  ep_utc_time.element_position.y = ep_utc_label.element_position.y + small_height * 0.5;
-  ep_lst_time.element_position.y = ep_lst_label.element_position.y;
-  ep_local_time.element_position.h = ep_local_label.element_position.h;
-  ep_utc_time.element_position.h = ep_utc_label.element_position.h;
-  ep_lst_time.element_position.h = ep_lst_label.element_position.h;
-  // The font used depends on the height of the panel.
-  ep_local_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_42_MEDIUM_NUMBERS);
-  ep_utc_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_42_MEDIUM_NUMBERS);
-  ep_lst_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-
-  // Now the two date elements.
-  // The local date appears just below the local time, and covers the
-  // entire width of the display.
-  ep_date.element_position.x = 0;
-  ep_date.element_position.w = bounds.size.w;
-  ep_date.element_position.h = small_height;
-  ep_date.element_position.y = ep_local_time.element_position.y + ep_local_time.element_position.h -
-    ep_date.element_position.h * 0.1;
-  // It uses a smallish font.
-  ep_date.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  // The MJD is just above the UTC.
-  ep_mjd.element_position.x = label_width;
-  ep_mjd.element_position.w = time_width;
-  ep_mjd.element_position.h = small_height;
-  ep_mjd.element_position.y = ep_local_time.element_position.y + ep_local_time.element_position.h +
-    ep_date.element_position.h;
-  // And its text is aligned to the right.
-  ep_mjd.text_alignment = GTextAlignmentRight;
-  ep_mjd.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-
-  // The DST indicator is under the "L" label (because DST is local).
-  ep_dst.element_position.x = 0;
-  ep_dst.element_position.w = label_width;
-  ep_dst.element_position.h = small_height;
-  ep_dst.element_position.y = ep_local_label.element_position.h - ep_dst.element_position.h * 1.2;
-  // It has label colouring, except yellow text.
-  ep_dst.background_colour = GColorBlack;
-  ep_dst.foreground_colour = GColorYellow;
-  // Small text, centered.
-  ep_dst.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  ep_dst.text_alignment = GTextAlignmentCenter;
-  
-  // Add the panels in the right order.
-  add_element_to_draw(&elementOrder, &nelements, &ep_local_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_date);
-  add_element_to_draw(&elementOrder, &nelements, &ep_utc_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_lst_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_mjd);
-  add_element_to_draw(&elementOrder, &nelements, &ep_dst);
+
+  // Note how each field looks when it isn't compact, and the LST label.
+  for (i = 0; i < face_layout_count; i++) {
+    const elementLayout *element = &face_layout[i];
+    if (element->field != FIELD_NONE) {
+      s_fields[element->field].font_key = element->font_key;
+    }
+    if (element->field == FIELD_LST_LABEL) {
+      s_lst_label = element->label;
+    }
+  }
+
+#ifdef RENDER_CANVAS
+  for (i = 0; i < face_layout_count; i++) {
+    s_element_fonts[i] = fonts_get_system_font(face_layout[i].font_key);
+    if (face_layout[i].field == FIELD_LST_SECONDS) {
+      s_seconds_element = i;
+    }
+    // The seconds are drawn over the LST panel, so that's what to clear them to.
+    if (face_layout[i].field == FIELD_LST_TIME) {
+      s_seconds_backdrop = face_layout[i].background_colour;
+    }
+  }
+  window_set_background_color(window, GColorClear);
+  s_compact_font = fonts_get_system_font(lst_compact_font_key);
+  s_canvas_layer = layer_create(layer_get_bounds(window_layer));
+  layer_set_update_proc(s_canvas_layer, canvas_update_proc);
+  layer_add_child(window_layer, s_canvas_layer);
+#else
+  // Make each of the elements, in the order they are drawn.
+  for (i = 0; i < face_layout_count; i++) {
+    const elementLayout *element = &face_layout[i];
+    TextLayer *text_layer = text_layer_create(GRect(element->element_position.x,
+                                                    element->element_position.y,
+                                                    element->element_position.w,
+                                                    element->element_position.h));
+    text_layer_set_background_color(text_layer, element->background_colour);
+    text_layer_set_text_color(text_layer, element->foreground_colour);
+    text_layer_set_font(text_layer, fonts_get_system_font(element->font_key));
+    text_layer_set_text_alignment(text_layer, element->text_alignment);
+    text_layer_set_text(text_layer, element_text(element));
+    layer_add_child(window_layer, text_layer_get_layer(text_layer));
+    s_text_layers[i] = text_layer;
+    if (element->field != FIELD_NONE) {
+      s_fields[element->field].text_layer = text_layer;
+    }
+  }
 #endif
-#ifdef PBL_PLATFORM_CHALK
-  // We're running on a Pebble Time Round.
-  // Round watches have a slightly different layout, but the
-  // same three panels.
-
-  // The panels are mixed together somewhat more than for the rectangular face,
-  // so we define things a bit differently here.
-  // All elements now take up the entire width of the face, and are centered.
-  ep_local_label.element_position.x = 0;
-  ep_utc_label.element_position.x = 0;
-  ep_lst_label.element_position.x = 0;
-  ep_local_time.element_position.x = 0;
-  ep_utc_time.element_position.x = 0;
-  ep_lst_time.element_position.x = 0;
-  ep_date.element_position.x = 0;
-  ep_mjd.element_position.x = 0;
-  ep_local_label.element_position.w = bounds.size.w;
-  ep_utc_label.element_position.w = bounds.size.w;
-  ep_lst_label.element_position.w = bounds.size.w;
-  ep_local_time.element_position.w = bounds.size.w;
-  ep_utc_time.element_position.w = bounds.size.w;
-  ep_lst_time.element_position.w = bounds.size.w;
-  ep_date.element_position.w = bounds.size.w;
-  ep_mjd.element_position.w = bounds.size.w;
-  ep_local_label.text_alignment = GTextAlignmentCenter;
-  ep_utc_label.text_alignment = GTextAlignmentCenter;
-  ep_lst_label.text_alignment = GTextAlignmentCenter;
-  ep_mjd.text_alignment = GTextAlignmentCenter;
-
-  // Determine the positions of the labels and the panels together.
-  // At the top is the UTC label, and below that the time and MJD.
-  ep_utc_label.element_position.h = small_height;
-  ep_utc_label.element_position.y = 0;
-  ep_utc_label.background_colour = GColorBlack;
-  ep_utc_label.foreground_colour = GColorWhite;
-  ep_utc_time.element_position.h = full_height;
-  ep_utc_time.element_position.y = ep_utc_label.element_position.y + ep_utc_label.element_position.h * 0.5;
-  ep_mjd.element_position.h = small_height;
-  ep_mjd.element_position.y = ep_utc_time.element_position.h - ep_mjd.element_position.h * 0.65;
-  ep_mjd.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-
-  // Followed now by the local date.
-  ep_date.element_position.h = small_height;
-  ep_date.element_position.y = ep_utc_time.element_position.h + ep_date.element_position.h * 1.2;
-  ep_date.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  
-  // Then the local label and the time (this is where the watch is widest).
-  ep_local_label.element_position.h = small_height;
-  ep_local_label.element_position.y = ep_utc_time.element_position.h + ep_date.element_position.h * 0.35;
-  ep_local_time.element_position.h = full_height - ep_date.element_position.h;
-  ep_local_time.element_position.y = ep_date.element_position.y + ep_date.element_position.h * 0.5;
-
-  // The DST indicator is to the right of the local time (because DST is local).
-  ep_dst.element_position.x = bounds.size.w * 0.84;
-  ep_dst.element_position.w = bounds.size.w - ep_dst.element_position.x;
-  ep_dst.element_position.h = small_height;
-  ep_dst.element_position.y = ep_local_time.element_position.y + 1.5 * ep_dst.element_position.h;
-  // It has the same colour as the local time, except red text.
-  ep_dst.background_colour = ep_local_time.background_colour;
-  ep_dst.foreground_colour = GColorBlack;
-  // Small text, centered.
-  ep_dst.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  ep_dst.text_alignment = GTextAlignmentLeft;
-  
-  // Finally, the LST time and then label.
-  ep_lst_time.element_position.y = ep_local_time.element_position.y + ep_local_time.element_position.h * 0.9;
-  ep_lst_time.element_position.h = bounds.size.h - ep_lst_time.element_position.y;
-  ep_lst_label.element_position.h = small_height;
-  ep_lst_label.element_position.y = bounds.size.h - ep_lst_label.element_position.h;
-  
-  // Each label has the same foreground and background colour.
-  ep_local_label.background_colour = GColorBlack;
-  ep_lst_label.background_colour = GColorBlack;
-  ep_local_label.foreground_colour = GColorWhite;
-  ep_lst_label.foreground_colour = GColorWhite;
-  // And each uses the same font and alignment.
-  ep_local_label.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  ep_utc_label.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-  ep_lst_label.text_font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
-
-  // The font used for each time depends on the height of the panel.
-  ep_local_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_42_MEDIUM_NUMBERS);
-  ep_utc_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_42_MEDIUM_NUMBERS);
-  ep_lst_time.text_font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-
-  // Add the panels in the right order.
-  add_element_to_draw(&elementOrder, &nelements, &ep_utc_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_utc_label);
-  add_element_to_draw(&elementOrder, &nelements, &ep_lst_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_local_time);
-  add_element_to_draw(&elementOrder, &nelements, &ep_dst);
-  add_element_to_draw(&elementOrder, &nelements, &ep_mjd);
-  add_element_to_draw(&elementOrder, &nelements, &ep_date);
-  add_element_to_draw(&elementOrder, &nelements, &ep_local_label);
-  add_element_to_draw(&elementOrder, &nelements, &ep_lst_label);
+
+  // The new layers have nothing in them yet.
+  invalidate_fields();
+}
+
+#ifdef RENDER_CANVAS
+static void main_window_appear(Window *window) {
+  (void)window;
+  // Whatever covered the window has drawn over our last frame.
+  s_canvas_full_redraw = true;
+}
 #endif
-  
-#ifdef PBL_SDK_2
-  int GColorYellow, GColorPastelYellow, GColorMintGreen, GColorPictonBlue;
-  GColorYellow=GColorWhite;
-  GColorPastelYellow=GColorMintGreen=GColorPictonBlue=GColorClear;
+
+static void main_window_unload(Window *window) {
+  int i;
+  (void)window;
+#ifdef RENDER_CANVAS
+  layer_destroy(s_canvas_layer);
+  s_canvas_layer = NULL;
+#else
+  // Destroy all the text layers that we made.
+  for (i = 0; i < face_layout_count; i++) {
+    text_layer_destroy(s_text_layers[i]);
+    s_text_layers[i] = NULL;
+  }
 #endif
+  for (i = 0; i < NUM_FIELDS; i++) {
+    s_fields[i].text_layer = NULL;
+  }
+}
 
-  // Go through the labels to make in the right order.
-  for (i = 0; i < nelements; i++) {
-    elementOrder[i]->window_layer = window_layer;
-    *(elementOrder[i]->text_layer) = NULL;
-    add_window_element(elementOrder[i]);
+// Take a chunk of the user-set configuration.
+static void receive_config_chunk(const Tuple *chunk_t) {
+  DictionaryIterator *out;
+  configStatus status;
+  int32_t ack;
+  // The configuration replaces what's in flash, so read that first.
+  complete_launch();
+  status = config_receive(chunk_t->value->data, chunk_t->length, &ack);
+
+  // Tell the phone what to send next before doing anything else.
+  if ((app_message_outbox_begin(&out) == APP_MSG_OK) &&
+      (dict_write_int32(out, KEY_CONFIG_ACK, ack) == DICT_OK) &&
+      (app_message_outbox_send() == APP_MSG_OK)) {
+    INSTRUMENT_COUNT(COUNTER_MESSAGES_SENT, 1);
+    INSTRUMENT_COUNT(COUNTER_BYTES_SENT, sizeof(ack));
+  } else {
+    INSTRUMENT_COUNT(COUNTER_SENDS_FAILED, 1);
   }
 
-// Set the text for each label.
+  if (status == CONFIG_APPLIED) {
+    update_sidereal_settings();
+    if (settings_get()->seconds_timeout_s == 0) {
+      s_seconds.active = false;
+    }
+    if (s_lst_panel >= lst_panel_count()) {
+      s_lst_panel = 0;
+    }
+    if (s_source_site >= settings_get()->num_sites) {
+      s_source_site = 0;
+    }
+    // Do an immediate update of the time.
+    update_time();
+  }
+}
 
-#ifdef PBL_PLATFORM_BASALT
-  text_layer_set_text(s_utc_label, "U");
-  text_layer_set_text(s_local_label, "L");
-  text_layer_set_text(s_lst_label, "S");
+static void inbox_received_handler(DictionaryIterator *iter, void *context) {
+  Tuple *chunk_t = dict_find(iter, KEY_CONFIG_CHUNK);
+#ifdef INSTRUMENT
+  Tuple *stats_t = dict_find(iter, KEY_STATS_REQUEST);
 #endif
-#ifdef PBL_PLATFORM_CHALK
-  text_layer_set_text(s_utc_label, "UTC");
-  text_layer_set_text(s_local_label, "LOCAL");
-  text_layer_set_text(s_lst_label, "LST");
+  (void)context;
+  INSTRUMENT_START(start);
+  INSTRUMENT_COUNT(COUNTER_MESSAGES_RECEIVED, 1);
+#ifdef INSTRUMENT
+  if (stats_t) {
+    INSTRUMENT_COUNT(COUNTER_BYTES_RECEIVED, stats_t->length);
+    instrument_send(stats_t->value->int32);
+  }
 #endif
+  if (chunk_t) {
+    INSTRUMENT_COUNT(COUNTER_BYTES_RECEIVED, chunk_t->length);
+    receive_config_chunk(chunk_t);
+  }
+  INSTRUMENT_STOP(PROBE_MESSAGE, start);
 }
 
-static void main_window_unload(Window *window) {
-  // Destroy all the text layers that we made.
+#ifdef INSTRUMENT
+static void inbox_dropped_handler(AppMessageResult reason, void *context) {
+  (void)reason;
+  (void)context;
+  INSTRUMENT_COUNT(COUNTER_MESSAGES_DROPPED, 1);
+}
+#endif
+
+static void tap_handler(AccelAxisType axis, int32_t direction) {
+  uint8_t timeout_s;
+  int num_panels;
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  int64_t now_ms = (int64_t)t * 1000 + ms;
+  bool woken = false;
+  (void)axis;
+  (void)direction;
+  INSTRUMENT_START(start);
+  // The panels on offer depend on the catalogue.
+  complete_launch();
+  timeout_s = settings_get()->seconds_timeout_s;
+  num_panels = lst_panel_count();
+  // In seconds mode the two gestures are kept apart on a site's panel: a
+  // flick while the seconds are gone brings them back, and one while
+  // they're up moves the panel on, leaving them to go when they would have.
+  // With only the one panel, there's nothing to move on to, so it keeps
+  // them up for longer. The other panels can't show the seconds, so there
+  // a flick moves the panel on at once, and has them ready for when it
+  // comes round to a site.
+  if (timeout_s > 0) {
+    woken = (lst_panel_kind(s_lst_panel) == PANEL_SITE) &&
+            (!s_seconds.active || (now_ms >= s_seconds.until_ms));
+    if (woken || (num_panels <= 1) || (lst_panel_kind(s_lst_panel) != PANEL_SITE)) {
+      s_seconds.active = true;
+      s_seconds.until_ms = now_ms + 1000 * (int64_t)timeout_s;
+    }
+    if (woken) {
+      update_time();
+    }
+  }
+  // Move the LST panel on to the next site, then to all of them, then to the
+  // sources.
+  if (!woken && (num_panels > 1)) {
+    s_lst_panel = (s_lst_panel + 1) % num_panels;
+    update_time();
+  }
+  INSTRUMENT_STOP(PROBE_TAP, start);
+}
+
+// Paint the face as it was in the snapshot.
+static void show_snapshot(const Snapshot *snapshot) {
+  const char *texts[NUM_FIELDS];
   int i;
-  for (i = 0; i < num_text_layers; i++) {
-    text_layer_destroy(all_text_layers[i]);
+  if (!snapshot_get_texts(snapshot, texts, NUM_FIELDS)) {
+    return;
   }
-  
+  for (i = 0; i < NUM_FIELDS; i++) {
+    set_field_compact((displayFieldId)i, (snapshot->compact_fields >> i) & 1);
+    set_field_text((displayFieldId)i, texts[i]);
+  }
+  flush_fields();
 }
 
-static void inbox_received_handler(DictionaryIterator *iter, void *context) {
-  // Get user-set configuration. 
-  Tuple *longitude_t = dict_find(iter, KEY_LONGITUDE);
-  if (longitude_t) {
-    double lng = (double)longitude_t->value->int32 / 1e7;
-    persist_write_data(KEY_LONGITUDE, &lng, sizeof(double));
-    // Do an immediate update of the time.
-    update_time();
+static void launch_timer_handler(void *data) {
+  (void)data;
+  update_time();
+}
+
+// Take a snapshot of the face as it is, for the next launch.
+static void save_snapshot() {
+  Snapshot snapshot;
+  const char *texts[NUM_FIELDS];
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  int i;
+  // If the launch never finished, the last snapshot still stands.
+  if (s_launch_pending) {
+    return;
+  }
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.taken_ms = (int64_t)t * 1000 + ms;
+  snapshot.anchor = s_gmst_anchor;
+  snapshot.settings = *settings_get();
+  snapshot.version = SNAPSHOT_VERSION;
+  snapshot.settings_version = SETTINGS_VERSION;
+  snapshot.lst_panel = (uint8_t)s_lst_panel;
+  snapshot.source_site = (uint8_t)s_source_site;
+  for (i = 0; i < NUM_FIELDS; i++) {
+    texts[i] = s_fields[i].text;
+    snapshot.compact_fields |= (uint16_t)(s_fields[i].compact << i);
+  }
+  // Seconds mode is off at launch.
+  texts[FIELD_LST_SECONDS] = "";
+  if (snapshot_set_texts(&snapshot, texts, NUM_FIELDS)) {
+    snapshot_save(&snapshot);
   }
 }
 
 static void handle_init(void) {
+  Snapshot snapshot;
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  bool warm;
+  instrument_init();
+  warm = snapshot_load(&snapshot, (int64_t)t * 1000 + ms);
+  // Everything after this is served from RAM.
+  if (warm) {
+    settings_restore(&snapshot.settings);
+    s_gmst_anchor = snapshot.anchor;
+    s_lst_panel = snapshot.lst_panel;
+    s_source_site = snapshot.source_site;
+    s_launch_pending = true;
+  } else {
+    settings_load();
+    catalogue_load();
+  }
+  update_sidereal_settings();
+
   s_my_window = window_create();
 
   window_set_window_handlers(s_my_window, (WindowHandlers) {
     .load = main_window_load,
+#ifdef RENDER_CANVAS
+    .appear = main_window_appear,
+#endif
     .unload = main_window_unload
   });
   
   window_stack_push(s_my_window, true);
+  if (warm) {
+    show_snapshot(&snapshot);
+    // Catch up once the first frame is up.
+    app_timer_register(0, launch_timer_handler, NULL);
+  }
   
   app_message_register_inbox_received(inbox_received_handler);
-  app_message_open(app_message_inbox_size_maximum(), app_message_outbox_size_maximum());
+  // The buffers only need to hold one configuration chunk and its ack.
+#ifdef INSTRUMENT
+  // Or a record of the stats.
+  app_message_register_inbox_dropped(inbox_dropped_handler);
+  app_message_open(config_inbox_size(), (instrument_outbox_size() > config_outbox_size()) ?
+                   instrument_outbox_size() : config_outbox_size());
+#else
+  app_message_open(config_inbox_size(), config_outbox_size());
+#endif
 }
 
 static void handle_deinit(void) {
+  save_snapshot();
   window_destroy(s_my_window);
+  catalogue_unload();
 }
 
-static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-  // Run three times per minute.
-  if (tick_time->tm_sec % 20) {
-    return;
+static void rollover_timer_handler(void *data) {
+  // A clock has just rolled over.
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  int64_t now_ms = (int64_t)t * 1000 + ms;
+  turns_t lst = s_seconds.lst + SIDEREAL_RATE_MS * (turns_t)(now_ms - s_seconds.at_ms);
+  INSTRUMENT_START(start);
+  (void)data;
+  s_rollover_timer = NULL;
+  // How late the display is, which also counts the wakeups.
+  INSTRUMENT_VALUE(PROBE_LATENCY, (now_ms > s_rollover_target_ms) ?
+                   (uint32_t)(now_ms - s_rollover_target_ms) * 1000 : 0);
+  instrument_log_hourly();
+  // Within the same solar and sidereal minute, only the seconds have changed.
+  if (seconds_showing() && (now_ms < s_seconds.until_ms) &&
+      (now_ms / 60000 == s_seconds.at_ms / 60000) &&
+      (sidereal_minutes(lst) == sidereal_minutes(s_seconds.lst))) {
+    update_seconds(now_ms, lst);
+  } else {
+    update_time();
   }
-  update_time();
+  INSTRUMENT_STOP(PROBE_TIMER, start);
 }
 
 int main(void) {
   handle_init();
-  // Register with TickTimerService
-  tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
-  update_time();
+  // There's no tick subscription: update_time arms the rollover timer itself.
+  accel_tap_service_subscribe(tap_handler);
+  if (!s_launch_pending) {
+    update_time();
+  }
   app_event_loop();
-  tick_timer_service_unsubscribe();
+  accel_tap_service_unsubscribe();
   handle_deinit();
+  return(0);
 }
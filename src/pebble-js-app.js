@@ -1,3 +1,190 @@
+// The configuration goes to the watch as one binary payload, in chunks small
+// enough for the watch's inbox; see src/config.h for the layout. The watch
+// acks each chunk with how much of the payload it holds, and we carry on
+// from there, so a lost or refused message is just sent again.
+var CONFIG_VERSION = 1;
+var CONFIG_CHUNK_DATA = 120;
+var CONFIG_HAS_CATALOGUE = 0x01;
+var CONFIG_MAX_CATALOGUE = 2048;
+var MAX_SITES = 4;
+var SITE_NAME_LENGTH = 8;
+var CATALOGUE_NAME_LENGTH = 8;
+var MAX_RETRIES = 5;
+var RETRY_MS = 1000;
+var ACK_TIMEOUT_MS = 5000;
+
+var putString = function(view, offset, s, length) {
+  // Up to length - 1 characters, and the rest NULs.
+  for (var i = 0; i < length; i++) {
+    view.setUint8(offset + i, (i < length - 1 && i < s.length) ? (s.charCodeAt(i) & 0x7f) : 0);
+  }
+};
+
+// Fractions of a turn into 2^-32 turns.
+var turns32 = function(turns) {
+  return Math.round(turns * 4294967296) | 0;
+};
+
+var buildCatalogue = function(sources) {
+  var n = Math.min(sources.length, Math.floor((CONFIG_MAX_CATALOGUE - 8) / 20));
+  var view = new DataView(new ArrayBuffer(8 + n * 20));
+  for (var c = 0; c < 4; c++) {
+    view.setUint8(c, 'CAT1'.charCodeAt(c));
+  }
+  view.setUint16(4, n, true);
+  view.setUint16(6, 20, true);
+  for (var i = 0; i < n; i++) {
+    var offset = 8 + i * 20;
+    putString(view, offset, String(sources[i]['name'] || ''), CATALOGUE_NAME_LENGTH);
+    view.setUint32(offset + 8, turns32(sources[i]['ra'] / 24) >>> 0, true);
+    view.setInt32(offset + 12, turns32(sources[i]['dec'] / 360), true);
+    view.setInt32(offset + 16, turns32(sources[i]['elevation'] / 360), true);
+  }
+  return new Uint8Array(view.buffer);
+};
+
+var buildPayload = function(config_data) {
+  var sites = config_data['sites'];
+  if (!sites || sites.length === 0) {
+    // From the page before there were several sites.
+    sites = [ { 'name': '', 'longitude': config_data['longitude'] || 0, 'latitude': 0 } ];
+  }
+  sites = sites.slice(0, MAX_SITES);
+  // No sources, or none from a page that predates them, leaves the watch's
+  // catalogue as it is.
+  var sources = config_data['sources'];
+  var hasCatalogue = sources && sources.length > 0;
+  var catalogue = hasCatalogue ? buildCatalogue(sources) : new Uint8Array(0);
+  var view = new DataView(new ArrayBuffer(8 + sites.length * 16 + catalogue.length));
+  view.setUint8(0, CONFIG_VERSION);
+  view.setUint8(1, hasCatalogue ? CONFIG_HAS_CATALOGUE : 0);
+  view.setUint8(2, sites.length);
+  view.setUint8(3, Math.max(0, Math.min(255, Math.round(config_data['seconds_timeout'] || 0))));
+  view.setInt16(4, Math.round((config_data['dut1'] || 0) * 1000), true);
+  view.setUint16(6, catalogue.length, true);
+  for (var i = 0; i < sites.length; i++) {
+    var offset = 8 + i * 16;
+    view.setInt32(offset, sites[i]['longitude'] || 0, true);
+    view.setInt32(offset + 4, sites[i]['latitude'] || 0, true);
+    putString(view, offset + 8, String(sites[i]['name'] || ''), SITE_NAME_LENGTH);
+  }
+  var payload = new Uint8Array(view.buffer);
+  payload.set(catalogue, 8 + sites.length * 16);
+  return payload;
+};
+
+// The transfer in progress.
+var transfer = null;
+
+var sendChunk = function() {
+  var t = transfer;
+  var n = Math.min(CONFIG_CHUNK_DATA, t.payload.length - t.offset);
+  var chunk = [ CONFIG_VERSION, 0,
+                t.payload.length & 0xff, t.payload.length >> 8,
+                t.offset & 0xff, t.offset >> 8 ];
+  for (var i = 0; i < n; i++) {
+    chunk.push(t.payload[t.offset + i]);
+  }
+  clearTimeout(t.timer);
+  // If no ack comes back, try the chunk again.
+  t.timer = setTimeout(retryChunk, ACK_TIMEOUT_MS);
+  Pebble.sendAppMessage({ 'CONFIG_CHUNK': chunk }, function() {}, retryChunk);
+};
+
+var retryChunk = function() {
+  var t = transfer;
+  if (!t) {
+    return;
+  }
+  clearTimeout(t.timer);
+  if (++t.retries > MAX_RETRIES) {
+    console.log('Giving up sending config data at byte ' + t.offset);
+    transfer = null;
+    return;
+  }
+  t.timer = setTimeout(sendChunk, RETRY_MS * t.retries);
+};
+
+// Watch builds with INSTRUMENT keep counters and timers, and send them a
+// record at a time when asked; see src/instrument.h for the layout. Others
+// never answer, so asking costs them one message; it's only asked on start
+// with REQUEST_STATS set, for talking to an INSTRUMENT build.
+var REQUEST_STATS = false;
+var STATS_VERSION = 2;
+var STATS_COUNTERS = [ 'flash reads', 'flash writes', 'messages in', 'bytes in',
+                       'messages dropped', 'messages out', 'bytes out', 'sends failed' ];
+var STATS_PROBES = [ 'timer', 'tap', 'message', 'update_time', 'gmst', 'format', 'lst panel',
+                     'flush', 'draw', 'latency' ];
+var STATS_FIELDS = 8;
+var STATS_BUCKETS = 16;
+
+var requestStats = function(index) {
+  Pebble.sendAppMessage({ 'STATS_REQUEST': index }, function() {}, function() {
+    console.log('Could not ask the watch for stats record ' + index);
+  });
+};
+
+var statsReceived = function(record) {
+  var view = new DataView(new Uint8Array(record).buffer);
+  var index = view.getUint8(1), count = view.getUint8(2);
+  var i, out = {};
+  if (view.getUint8(0) !== STATS_VERSION) {
+    return;
+  }
+  if (index === 0) {
+    out['uptime_s'] = view.getUint32(4, true);
+    for (i = 0; i < STATS_COUNTERS.length; i++) {
+      out[STATS_COUNTERS[i]] = view.getUint32(8 + 4 * i, true);
+    }
+    out['redraws'] = [];
+    for (i = 0; i < STATS_FIELDS; i++) {
+      out['redraws'].push(view.getUint32(8 + 4 * (STATS_COUNTERS.length + i), true));
+    }
+  } else {
+    out['probe'] = STATS_PROBES[index - 1];
+    out['count'] = view.getUint32(4, true);
+    out['total_us'] = view.getUint32(8, true);
+    out['max_us'] = view.getUint32(12, true);
+    out['buckets'] = [];
+    for (i = 0; i < STATS_BUCKETS; i++) {
+      out['buckets'].push(view.getUint32(16 + 4 * i, true));
+    }
+  }
+  console.log('Watch stats: ' + JSON.stringify(out));
+  if (index + 1 < count) {
+    requestStats(index + 1);
+  }
+};
+
+Pebble.addEventListener('ready', function(e) {
+  if (REQUEST_STATS) {
+    requestStats(0);
+  }
+});
+
+Pebble.addEventListener('appmessage', function(e) {
+  if (typeof e.payload['STATS'] !== 'undefined') {
+    statsReceived(e.payload['STATS']);
+  }
+  var ack = e.payload['CONFIG_ACK'];
+  var t = transfer;
+  if (!t || typeof ack === 'undefined') {
+    return;
+  }
+  clearTimeout(t.timer);
+  if (ack < 0) {
+    console.log('Watch refused config data: ' + ack);
+    transfer = null;
+  } else if (ack >= t.payload.length) {
+    console.log('Sent config data to Pebble');
+    transfer = null;
+  } else {
+    t.offset = ack;
+    t.retries = 0;
+    sendChunk();
+  }
+});
+
 Pebble.addEventListener('showConfiguration', function(e) {
   // Show config page
   Pebble.openURL('http://astrowebservices.com/~ste616/tools/cityLongitude/index.html');
@@ -7,16 +194,10 @@ Pebble.addEventListener('webviewclosed', function(e) {
   var config_data = JSON.parse(decodeURIComponent(e.response));
   console.log('Config window returned: ', JSON.stringify(config_data));
 
-  // Prepare AppMessage payload
-  var dict = {
-    'LONGITUDE': config_data['longitude']
-  };
-
-  // Send settings to Pebble watchapp
-  Pebble.sendAppMessage(dict, function(){
-    console.log('Sent config data to Pebble');  
-  }, function() {
-    console.log('Failed to send config data!');
-  });
+  // Send settings to Pebble watchapp, replacing anything still on its way.
+  if (transfer) {
+    clearTimeout(transfer.timer);
+  }
+  transfer = { 'payload': buildPayload(config_data), 'offset': 0, 'retries': 0, 'timer': null };
+  sendChunk();
 });
-
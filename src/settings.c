@@ -0,0 +1,104 @@
+#include "settings.h"
+#include "instrument.h"
+
+// The persistent storage keys.
+// Version 0 stored only the longitude, as a double in degrees.
+#define PERSIST_KEY_LONGITUDE_V0 0
+#define PERSIST_KEY_SETTINGS_VERSION 1
+#define PERSIST_KEY_SETTINGS 2
+
+static Settings s_settings;
+
+// Fill in the values for a fresh install.
+static void settings_defaults(Settings *settings) {
+  memset(settings, 0, sizeof(Settings));
+  settings->sites[0].longitude_e7 = 0; // 1495501388; // ATCA longitude.
+  settings->num_sites = 1;
+}
+
+// Bring a version 0 install (just the longitude) up to the current schema.
+static void settings_migrate_v0(Settings *settings) {
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+  if (persist_exists(PERSIST_KEY_LONGITUDE_V0)) {
+    double longitude;
+    INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+    persist_read_data(PERSIST_KEY_LONGITUDE_V0, &longitude, sizeof(double));
+    settings->sites[0].longitude_e7 = (int32_t)(longitude * 1e7 + (longitude < 0 ? -0.5 : 0.5));
+    INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+    persist_delete(PERSIST_KEY_LONGITUDE_V0);
+  }
+}
+
+// Compare two settings field by field, since the padding between the fields
+// can hold anything.
+static bool settings_equal(const Settings *a, const Settings *b) {
+  int i;
+  if ((a->num_sites != b->num_sites) || (a->dut1_ms != b->dut1_ms) ||
+      (a->seconds_timeout_s != b->seconds_timeout_s)) {
+    return(false);
+  }
+  for (i = 0; i < MAX_SITES; i++) {
+    if ((a->sites[i].longitude_e7 != b->sites[i].longitude_e7) ||
+        (strncmp(a->sites[i].name, b->sites[i].name, SITE_NAME_LENGTH) != 0) ||
+        (a->latitudes_e7[i] != b->latitudes_e7[i])) {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+static void settings_save(void) {
+  INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 2);
+  persist_write_int(PERSIST_KEY_SETTINGS_VERSION, SETTINGS_VERSION);
+  persist_write_data(PERSIST_KEY_SETTINGS, &s_settings, sizeof(Settings));
+}
+
+void settings_load(void) {
+  int i;
+  settings_defaults(&s_settings);
+
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+  if (!persist_exists(PERSIST_KEY_SETTINGS_VERSION)) {
+    settings_migrate_v0(&s_settings);
+    settings_save();
+    return;
+  }
+
+  // Records from older versions are shorter, so they only overwrite the
+  // leading fields and leave the newer ones at their defaults. Records from
+  // newer versions are truncated to the fields we know about.
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 2);
+  int32_t version = persist_read_int(PERSIST_KEY_SETTINGS_VERSION);
+  persist_read_data(PERSIST_KEY_SETTINGS, &s_settings, sizeof(Settings));
+  if ((s_settings.num_sites < 1) || (s_settings.num_sites > MAX_SITES)) {
+    s_settings.num_sites = 1;
+  }
+  for (i = 0; i < MAX_SITES; i++) {
+    s_settings.sites[i].name[SITE_NAME_LENGTH - 1] = '\0';
+  }
+  // A version 4 record is as long as this one, since seconds_timeout_s
+  // went into what was its padding.
+  if (version < SETTINGS_VERSION_SECONDS) {
+    s_settings.seconds_timeout_s = 0;
+  }
+  if (version < SETTINGS_VERSION) {
+    settings_save();
+  }
+}
+
+void settings_restore(const Settings *settings) {
+  s_settings = *settings;
+}
+
+const Settings *settings_get(void) {
+  return(&s_settings);
+}
+
+bool settings_update(const Settings *settings) {
+  if (settings_equal(&s_settings, settings)) {
+    return(false);
+  }
+  s_settings = *settings;
+  settings_save();
+  return(true);
+}
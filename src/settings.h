@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pebble.h>
+
+// The persisted settings schema version. Bump this whenever a field is added
+// to the end of Settings, with a name for the version that added it; never
+// reorder or remove fields, so that a record written by an older version can
+// still be read as a prefix of the new one.
+#define SETTINGS_VERSION_LONGITUDE 1
+#define SETTINGS_VERSION_SITES 2
+#define SETTINGS_VERSION_LATITUDES 3
+#define SETTINGS_VERSION_DUT1 4
+#define SETTINGS_VERSION_SECONDS 5
+#define SETTINGS_VERSION SETTINGS_VERSION_SECONDS
+
+// The most sites the LST can be shown for, and the longest site name
+// (including its NUL).
+#define MAX_SITES 4
+#define SITE_NAME_LENGTH 8
+
+// A place to show the LST for.
+typedef struct _site {
+  // The longitude, in units of 1e-7 degrees, east positive.
+  int32_t longitude_e7;
+  char name[SITE_NAME_LENGTH];
+} Site;
+
+// Everything the user can configure. All fields are served from RAM; nothing
+// here should ever require a flash read after settings_load().
+typedef struct _settings {
+  // The sites, of which the first num_sites are in use. Version 1 stored
+  // only a longitude, which lands in the first site's longitude_e7.
+  Site sites[MAX_SITES];
+  uint8_t num_sites;
+  // Version 3: the latitude of each site, in units of 1e-7 degrees, north
+  // positive, for working out when sources rise and set.
+  int32_t latitudes_e7[MAX_SITES];
+  // Version 4: UT1 - UTC, in milliseconds, as sent by the phone.
+  int16_t dut1_ms;
+  // Version 5: how long the LST shows seconds after a flick of the wrist,
+  // in seconds, or 0 for never.
+  uint8_t seconds_timeout_s;
+} Settings;
+
+// Read all the persisted settings into RAM, migrating old records as needed.
+void settings_load(void);
+
+// Serve settings kept elsewhere, such as in a snapshot of the face, until
+// settings_load() is called. Nothing is written to flash.
+void settings_restore(const Settings *settings);
+
+// The current settings.
+const Settings *settings_get(void);
+
+// Replace the settings, writing them through to flash only if they changed.
+// Returns true if anything changed.
+bool settings_update(const Settings *settings);
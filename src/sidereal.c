@@ -0,0 +1,125 @@
+#include "sidereal.h"
+
+// GMST at 0h UT is evaluated in half-days from J2000 (MJD 51544.5).
+#define MJD_J2000_HALF_DAYS 103089
+#if SIDEREAL_PRECISION == SIDEREAL_IAU1982
+// 24110.54841 s in turns.
+#define GMST_A 5147698101806189265ULL
+// 8640184.812866 s per century, in turns per half-day.
+#define GMST_B_HALF_DAY 25252756545569238ULL
+// 0.093104 s per century^2, in turns per half-day^2, scaled by 2^16.
+#define GMST_E_Q16 244125873LL
+// 0.0000062 s per century^3, in turns per half-day^3, scaled by 2^32.
+#define GMST_D_Q32 14585LL
+#else
+// The Earth Rotation Angle at J2000, 0.7790572732640 turns, plus the
+// 0.014506" constant term of the IAU 2006 precession in right ascension.
+#define GMST_A 14371070345135599228ULL
+// Half a day of the ERA, 0.50136890595567724 turns modulo whole turns, plus
+// 4612.156534" per century of precession, in turns per half-day.
+#define GMST_B_HALF_DAY 9248624793346603070ULL
+// 1.3915817" per century^2, in turns per half-day^2, scaled by 2^16. The
+// higher terms add less than 5 us over the whole range, so are left out,
+// as is the difference between TT and UT1 in the century count (10 us).
+#define GMST_E_Q16 243255641LL
+#endif
+
+#if SIDEREAL_PRECISION == SIDEREAL_ERA_DUT1
+// UT1 - UTC, as the angle the ERA turns through in that time.
+static turns_t s_dut1;
+#define DUT1_TURNS s_dut1
+#else
+#define DUT1_TURNS 0
+#endif
+
+// How many elements sidereal_batch works on at a time, small enough that
+// its scratch arrays stay in L1.
+#define BATCH_BLOCK 256
+
+int32_t sidereal_mjd(int64_t t, int32_t *day_seconds) {
+  int32_t days = (int32_t)(t / SECONDS_PER_DAY);
+  int32_t secs = (int32_t)(t % SECONDS_PER_DAY);
+  if (secs < 0) {
+    // Times before 1970 still need to count forwards from midnight.
+    secs += SECONDS_PER_DAY;
+    days--;
+  }
+  if (day_seconds) {
+    *day_seconds = secs;
+  }
+  return(days + MJD_UNIX_EPOCH);
+}
+
+// GMST at 0h UT on day mjd. Kept inline so that the batch loop, which
+// calls it for every element, has no calls in it and vectorises.
+static inline turns_t gmst_at_0h(int32_t mjd) {
+  // The polynomial in Julian centuries only depends on the day number, and
+  // we count it in half-days so that J2000 lands on an integer.
+  int64_t m = 2 * (int64_t)mjd - MJD_J2000_HALF_DAYS;
+  int64_t m2 = m * m;
+  turns_t gmst = GMST_A + GMST_B_HALF_DAY * (turns_t)m;
+  gmst += (turns_t)((m2 * GMST_E_Q16) >> 16);
+#if SIDEREAL_PRECISION == SIDEREAL_IAU1982
+  gmst -= (turns_t)((m2 * m * GMST_D_Q32) >> 32);
+#endif
+  return(gmst);
+}
+
+#if SIDEREAL_PRECISION == SIDEREAL_ERA_DUT1
+void sidereal_set_dut1(int16_t dut1_ms) {
+  s_dut1 = SIDEREAL_RATE_MS * (turns_t)(int64_t)dut1_ms;
+}
+#endif
+
+turns_t sidereal_gmst(int32_t mjd, int32_t day_seconds) {
+  // Now add the sidereal time elapsed since 0h UT, and since 0h UTC.
+  return(gmst_at_0h(mjd) + SIDEREAL_RATE * (turns_t)day_seconds + DUT1_TURNS);
+}
+
+turns_t sidereal_time2gmst(siderealAnchor *anchor, int64_t t, uint16_t ms, int32_t *mjd,
+                           int32_t *day_seconds) {
+  int32_t secs;
+  int32_t day = sidereal_mjd(t, &secs);
+  if (!anchor->valid || (anchor->mjd != day)) {
+    anchor->gmst = gmst_at_0h(day);
+    anchor->mjd = day;
+    anchor->valid = true;
+  }
+  if (mjd) {
+    *mjd = day;
+  }
+  if (day_seconds) {
+    *day_seconds = secs;
+  }
+  // This is exactly the step sidereal_gmst takes, so there is no drift.
+  return(anchor->gmst + SIDEREAL_RATE * (turns_t)secs + SIDEREAL_RATE_MS * (turns_t)ms +
+         DUT1_TURNS);
+}
+
+void sidereal_batch(const int64_t *restrict t, const int32_t *restrict longitude_e7, size_t n,
+                    int32_t *restrict mjd, turns_t *restrict gmst, turns_t *restrict lst) {
+  int32_t day_seconds[BATCH_BLOCK];
+  size_t start, i, m;
+
+  for (start = 0; start < n; start += m) {
+    m = (n - start < BATCH_BLOCK) ? n - start : BATCH_BLOCK;
+    // Split each time into a day and the seconds into it. Counting from
+    // MJD 0 keeps everything positive, and 86400 = 2^7 * 675 brings the
+    // division down to 32 bits, where it vectorises.
+    for (i = 0; i < m; i++) {
+      uint64_t secs = (uint64_t)(t[start + i] + MJD_UNIX_EPOCH * (int64_t)SECONDS_PER_DAY);
+      uint32_t day = (uint32_t)(secs >> 7) / (SECONDS_PER_DAY >> 7);
+      mjd[start + i] = (int32_t)day;
+      day_seconds[i] = (int32_t)(secs - (uint64_t)day * SECONDS_PER_DAY);
+    }
+    for (i = 0; i < m; i++) {
+      gmst[start + i] = gmst_at_0h(mjd[start + i]) + SIDEREAL_RATE * (turns_t)day_seconds[i] +
+                        DUT1_TURNS;
+    }
+    if (lst) {
+      for (i = 0; i < m; i++) {
+        lst[start + i] = gmst[start + i] + sidereal_longitude(longitude_e7[start + i]);
+      }
+    }
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The sidereal engine: MJD, GMST and LST from the time, in integer
+// arithmetic only, since the watch has no FPU. It needs nothing from the
+// Pebble SDK, so host tools build the very same code the watch runs.
+//
+// Angles are held as fractions of a turn in units of 2^-64 turns, so
+// wrapping into [0, 1) turn is just the natural overflow of a uint64_t.
+typedef uint64_t turns_t;
+
+// How precisely GMST is worked out. The tier is picked at compile time, so
+// the cheaper ones carry none of the others' code:
+//   SIDEREAL_IAU1982   the IAU 1982 polynomial, with UT1 taken to be UTC
+//   SIDEREAL_ERA       the IAU 2006 GMST, from the Earth Rotation Angle,
+//                      with UT1 taken to be UTC
+//   SIDEREAL_ERA_DUT1  the same, from UT1 = UTC + dUT1 as sent by the phone
+// Only the evaluation at 0h UT differs between them; stepping on from
+// there costs the same in each, plus one addition for dUT1. All of them
+// overflow outside the years 1883 to 2117.
+#define SIDEREAL_IAU1982 1
+#define SIDEREAL_ERA 2
+#define SIDEREAL_ERA_DUT1 3
+
+// Define SIDEREAL_PRECISION to one of those to change the tier.
+// #define SIDEREAL_PRECISION SIDEREAL_ERA_DUT1
+#ifndef SIDEREAL_PRECISION
+#define SIDEREAL_PRECISION SIDEREAL_IAU1982
+#endif
+
+// The number of seconds in a day, and the MJD of the Unix epoch.
+#define SECONDS_PER_DAY 86400
+#define MJD_UNIX_EPOCH 40587
+// Sidereal turns per solar day, in turns per second and in turns per
+// millisecond: 1.002737909350795 for IAU 1982, and for IAU 2006 the Earth
+// Rotation Angle's 1.00273781191135448 plus the precession in right
+// ascension.
+#if SIDEREAL_PRECISION == SIDEREAL_IAU1982
+#define SIDEREAL_RATE 214088536884267ULL
+#define SIDEREAL_RATE_MS 214088536884ULL
+#else
+#define SIDEREAL_RATE 214088536883023ULL
+#define SIDEREAL_RATE_MS 214088536883ULL
+#endif
+// One minute, and one second, of sidereal time in turns: 2^64 / 1440 and
+// 2^64 / 86400, each rounded down, so a minute is within 60 units of sixty
+// seconds.
+#define SIDEREAL_MINUTE 12810238940076077ULL
+#define SIDEREAL_SECOND 213503982334601ULL
+// One 1e-7 degree of longitude in turns.
+#define LONGITUDE_E7 5124095576ULL
+
+// The Modified Julian Date (MJD) at the most recent 0h UT before t (in
+// seconds since the Unix epoch), and the number of seconds since then.
+int32_t sidereal_mjd(int64_t t, int32_t *day_seconds);
+
+// The sidereal time (GMST) at day_seconds past 0h UT on day mjd.
+turns_t sidereal_gmst(int32_t mjd, int32_t day_seconds);
+
+#if SIDEREAL_PRECISION == SIDEREAL_ERA_DUT1
+// Set UT1 - UTC, in milliseconds, for all the GMSTs worked out after.
+void sidereal_set_dut1(int16_t dut1_ms);
+#else
+// The other tiers take UT1 to be UTC.
+#define sidereal_set_dut1(dut1_ms) ((void)(dut1_ms))
+#endif
+
+// A longitude, in units of 1e-7 degrees east, in turns: a site's LST is
+// GMST plus this.
+static inline turns_t sidereal_longitude(int32_t longitude_e7) {
+  return(LONGITUDE_E7 * (turns_t)(int64_t)longitude_e7);
+}
+
+// The number of whole minutes into the (sidereal) day.
+static inline int sidereal_minutes(turns_t angle) {
+  return((int)(((angle >> 16) * 1440) >> 48));
+}
+
+// The number of whole seconds into the (sidereal) day.
+static inline int32_t sidereal_seconds(turns_t angle) {
+  return((int32_t)(((angle >> 20) * 86400) >> 44));
+}
+
+// The GMST polynomial only changes at 0h UT, so a clock evaluates it once
+// per UTC day and steps forward from there by the sidereal rate. Start
+// with one zeroed.
+typedef struct _sidereal_anchor {
+  bool valid;
+  int32_t mjd;
+  turns_t gmst;
+} siderealAnchor;
+
+// GMST at time t (plus ms milliseconds), re-anchoring if the UTC day has
+// changed since the last call. The MJD and the seconds since 0h UT are
+// passed back too, if wanted. This gives exactly what sidereal_gmst does.
+turns_t sidereal_time2gmst(siderealAnchor *anchor, int64_t t, uint16_t ms, int32_t *mjd,
+                           int32_t *day_seconds);
+
+// Convert n times at once, for tools that need millions of them. Each
+// array holds one field of every element (structure of arrays), so the
+// loops inside vectorise. For each t[i], in seconds since the Unix epoch,
+// mjd[i] and gmst[i] get what sidereal_mjd and sidereal_gmst give, and if
+// lst is not NULL, lst[i] gets the LST at longitude_e7[i]. The times must
+// be after MJD 0 (1858-11-17), and the arrays must not overlap.
+void sidereal_batch(const int64_t *t, const int32_t *longitude_e7, size_t n, int32_t *mjd,
+                    turns_t *gmst, turns_t *lst);
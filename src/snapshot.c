@@ -0,0 +1,55 @@
+#include "snapshot.h"
+#include "instrument.h"
+
+// The persistent storage key, after the settings' keys.
+#define PERSIST_KEY_SNAPSHOT 3
+
+_Static_assert(sizeof(Snapshot) <= PERSIST_DATA_MAX_LENGTH,
+               "the snapshot must fit in one persist entry");
+
+bool snapshot_load(Snapshot *snapshot, int64_t now_ms) {
+  INSTRUMENT_COUNT(COUNTER_PERSIST_READS, 1);
+  if (persist_read_data(PERSIST_KEY_SNAPSHOT, snapshot, sizeof(Snapshot)) !=
+      (int)sizeof(Snapshot)) {
+    return(false);
+  }
+  if ((snapshot->version != SNAPSHOT_VERSION) ||
+      (snapshot->settings_version != SETTINGS_VERSION)) {
+    return(false);
+  }
+  // If the clock has gone back, all bets are off.
+  return(now_ms >= snapshot->taken_ms);
+}
+
+void snapshot_save(const Snapshot *snapshot) {
+  INSTRUMENT_COUNT(COUNTER_PERSIST_WRITES, 1);
+  persist_write_data(PERSIST_KEY_SNAPSHOT, snapshot, sizeof(Snapshot));
+}
+
+bool snapshot_set_texts(Snapshot *snapshot, const char *const texts[], int n) {
+  size_t used = 0;
+  int i;
+  for (i = 0; i < n; i++) {
+    size_t length = strlen(texts[i]) + 1;
+    if (used + length > SNAPSHOT_TEXT_LENGTH) {
+      return(false);
+    }
+    memcpy(snapshot->texts + used, texts[i], length);
+    used += length;
+  }
+  return(true);
+}
+
+bool snapshot_get_texts(const Snapshot *snapshot, const char *texts[], int n) {
+  const char *p = snapshot->texts, *end = snapshot->texts + SNAPSHOT_TEXT_LENGTH;
+  int i;
+  for (i = 0; i < n; i++) {
+    const char *nul = memchr(p, '\0', end - p);
+    if (!nul) {
+      return(false);
+    }
+    texts[i] = p;
+    p = nul + 1;
+  }
+  return(true);
+}
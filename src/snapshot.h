@@ -0,0 +1,50 @@
+#pragma once
+
+#include <pebble.h>
+#include "settings.h"
+#include "sidereal.h"
+
+// What the face last showed, kept when it exits so that the next launch can
+// paint its first frame straight from flash, with one read and none of the
+// sidereal or formatting work, and catch up after that frame is up. The
+// clocks it shows may be stale by then, but they're put right by the first
+// update, which runs as soon as the frame is up, so every relaunch starts
+// warm, however long after the last run it comes.
+
+// Bump this whenever Snapshot, or the fields it holds the text of, change.
+// The sidereal tier is part of it, since the anchor depends on the tier.
+#define SNAPSHOT_VERSION (2 + 16 * SIDEREAL_PRECISION)
+
+// Room for the text of every field, one after another with their NULs, so
+// that the record still fits in one persist entry.
+#define SNAPSHOT_TEXT_LENGTH 128
+
+typedef struct _snapshot {
+  // When it was taken.
+  int64_t taken_ms;
+  // The GMST at the start of the UTC day then, to step on from.
+  siderealAnchor anchor;
+  Settings settings;
+  uint8_t version;
+  uint8_t settings_version;
+  uint8_t lst_panel;
+  uint8_t source_site;
+  // Which fields were compact, one bit each.
+  uint16_t compact_fields;
+  char texts[SNAPSHOT_TEXT_LENGTH];
+} Snapshot;
+
+// Read the snapshot, returning false if there isn't one, it's from another
+// version, or it was taken after now_ms.
+bool snapshot_load(Snapshot *snapshot, int64_t now_ms);
+
+// Keep the snapshot for the next launch.
+void snapshot_save(const Snapshot *snapshot);
+
+// Pack the text of n fields into the snapshot, returning false if they
+// don't fit.
+bool snapshot_set_texts(Snapshot *snapshot, const char *const texts[], int n);
+
+// Point texts at the n fields' text in the snapshot, returning false if it
+// holds fewer than that.
+bool snapshot_get_texts(const Snapshot *snapshot, const char *texts[], int n);